@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "events.h"
+
+// Returns true if event a should fire before event b
+bool eventBefore(const Event* a, const Event* b) {
+  if (a->time != b->time) return a->time < b->time;
+  return a->sequence < b->sequence;
+}
+
+void swapEvents(Event* a, Event* b) {
+  Event t = *a;
+  *a = *b;
+  *b = t;
+}
+
+// Initialize an empty event queue with room for capacity events
+void initEventQueue(EventQueue* queue, int capacity) {
+  queue->events = malloc(sizeof(Event) * capacity);
+  if (queue->events == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  queue->count = 0;
+  queue->capacity = capacity;
+  queue->nextSequence = 0;
+}
+
+void freeEventQueue(EventQueue* queue) {
+  free(queue->events);
+  queue->events = NULL;
+  queue->count = 0;
+  queue->capacity = 0;
+}
+
+// Add an event to fire at the given simulated time (in nanoseconds)
+void scheduleEvent(EventQueue* queue, unsigned long long time, EventType type, int pid, int slot) {
+  if (queue->count == queue->capacity) {
+    queue->capacity *= 2;
+    queue->events = realloc(queue->events, sizeof(Event) * queue->capacity);
+    if (queue->events == NULL) {
+      perror("realloc");
+      exit(1);
+    }
+  }
+
+  int i = queue->count++;
+  queue->events[i].time = time;
+  queue->events[i].sequence = queue->nextSequence++;
+  queue->events[i].type = type;
+  queue->events[i].pid = pid;
+  queue->events[i].slot = slot;
+
+  // Sift the new event up to its place in the heap
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!eventBefore(&queue->events[i], &queue->events[parent])) break;
+    swapEvents(&queue->events[i], &queue->events[parent]);
+    i = parent;
+  }
+}
+
+// Look at the earliest event without removing it
+bool peekEvent(const EventQueue* queue, Event* event) {
+  if (queue->count == 0) return false;
+  *event = queue->events[0];
+  return true;
+}
+
+// Remove and return the earliest event
+bool popEvent(EventQueue* queue, Event* event) {
+  if (queue->count == 0) return false;
+  *event = queue->events[0];
+
+  queue->events[0] = queue->events[--queue->count];
+
+  // Sift the moved event down to its place in the heap
+  int i = 0;
+  while (true) {
+    int left = 2 * i + 1;
+    int right = left + 1;
+    int smallest = i;
+    if (left < queue->count && eventBefore(&queue->events[left], &queue->events[smallest])) smallest = left;
+    if (right < queue->count && eventBefore(&queue->events[right], &queue->events[smallest])) smallest = right;
+    if (smallest == i) break;
+    swapEvents(&queue->events[i], &queue->events[smallest]);
+    i = smallest;
+  }
+  return true;
+}
@@ -0,0 +1,37 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdbool.h>
+
+typedef enum {
+  EVENT_FAULT_DONE, // a blocked process's page has been brought in
+  EVENT_LAUNCH,     // the gap before the next process launch has elapsed
+  EVENT_PRINT,      // time to print the frame table
+  EVENT_WRITEBACK_DONE, // the disk finished the oldest queued page-out write
+  EVENT_LOAD_CHECK      // time for load control to look at the fault rate
+} EventType;
+
+typedef struct {
+  unsigned long long time;
+  unsigned long long sequence;
+  EventType type;
+  int pid;
+  int slot;
+} Event;
+
+// Binary min-heap of events ordered by simulated time. Events due at the same
+// time come out in the order they were scheduled.
+typedef struct {
+  Event* events;
+  int count;
+  int capacity;
+  unsigned long long nextSequence;
+} EventQueue;
+
+void initEventQueue(EventQueue* queue, int capacity);
+void freeEventQueue(EventQueue* queue);
+void scheduleEvent(EventQueue* queue, unsigned long long time, EventType type, int pid, int slot);
+bool peekEvent(const EventQueue* queue, Event* event);
+bool popEvent(EventQueue* queue, Event* event);
+
+#endif /* EVENTS_H */
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "prefetch.h"
+#include "loadctl.h"
+
+// Page-fault-frequency load control. When more of the references fault than the high
+// threshold, the processes together need more memory than there is and adding to their
+// fault waits only makes it worse, so the process faulting the most is swapped out: its
+// frames go back to the free pool and it is held off the CPU. Once the fault rate falls
+// below the low threshold, the process that has been out longest comes back and faults
+// its pages in again. Nothing new is launched while any process is out.
+//
+// A swapped-out process is held at its next exchange with oss: a request it sends is
+// parked unserved, and the reply to a fault it was blocked on is parked instead of
+// sent. Both go through when it is resumed.
+
+LoadControlConfig loadControlConfig;
+
+typedef enum {
+  SLOT_EMPTY,
+  SLOT_ACTIVE,
+  SLOT_SUSPENDED
+} LoadSlotState;
+
+typedef enum {
+  PARK_NONE,
+  PARK_REQUEST, // a request that arrived while the process was out
+  PARK_REPLY,   // the reply to the fault it was blocked on, held back
+  PARK_READY    // a parked request to serve now that the process is back
+} ParkState;
+
+// Per slot
+LoadSlotState* loadSlotStates;
+ParkState* loadParkStates;
+MemoryRequest* loadParkedRequests;
+unsigned long long* loadSuspendOrder; // when each slot was swapped out, in suspensions
+int* loadReferences;                  // references and faults since the last check
+int* loadFaults;
+int loadSlotCount;
+
+int loadReferenceTotal;
+int loadFaultTotal;
+int loadActiveCount;
+int loadSuspendedCount;
+int loadParkedCount;
+int loadReadyCount;
+int loadLastPercent;
+unsigned long long loadSuspensions;
+
+// Parse "low,high" from the command line
+bool parseLoadControlConfig(const char* text, LoadControlConfig* config) {
+  return sscanf(text, "%d,%d", &config->low, &config->high) == 2;
+}
+
+// Check that the thresholds are usable, printing the problem if they aren't
+bool checkLoadControlConfig(const LoadControlConfig* config) {
+  if (config->high == 0) return true;
+  if (config->low < 0 || config->high <= config->low || config->high > 100) {
+    fprintf(stderr, "Load control thresholds need 0 <= low < high <= 100 percent\n");
+    return false;
+  }
+  return true;
+}
+
+bool initLoadControl(int processCount) {
+  freeLoadControl();
+  if (loadControlConfig.high == 0) return true;
+
+  loadSlotStates = calloc(processCount, sizeof(LoadSlotState));
+  loadParkStates = calloc(processCount, sizeof(ParkState));
+  loadParkedRequests = malloc(sizeof(MemoryRequest) * processCount);
+  loadSuspendOrder = calloc(processCount, sizeof(unsigned long long));
+  loadReferences = calloc(processCount, sizeof(int));
+  loadFaults = calloc(processCount, sizeof(int));
+  if (loadSlotStates == NULL || loadParkStates == NULL || loadParkedRequests == NULL || loadSuspendOrder == NULL ||
+    loadReferences == NULL || loadFaults == NULL) {
+    perror("malloc");
+    freeLoadControl();
+    return false;
+  }
+  loadSlotCount = processCount;
+  loadReferenceTotal = 0;
+  loadFaultTotal = 0;
+  loadActiveCount = 0;
+  loadSuspendedCount = 0;
+  loadParkedCount = 0;
+  loadReadyCount = 0;
+  loadLastPercent = 0;
+  loadSuspensions = 0;
+  return true;
+}
+
+void freeLoadControl() {
+  free(loadSlotStates);
+  free(loadParkStates);
+  free(loadParkedRequests);
+  free(loadSuspendOrder);
+  free(loadReferences);
+  free(loadFaults);
+  loadSlotStates = NULL;
+  loadParkStates = NULL;
+  loadParkedRequests = NULL;
+  loadSuspendOrder = NULL;
+  loadReferences = NULL;
+  loadFaults = NULL;
+}
+
+bool loadControlEnabled() {
+  return loadSlotStates != NULL;
+}
+
+void loadControlLaunch(int slot) {
+  loadSlotStates[slot] = SLOT_ACTIVE;
+  loadParkStates[slot] = PARK_NONE;
+  loadReferences[slot] = 0;
+  loadFaults[slot] = 0;
+  loadActiveCount++;
+}
+
+// The process in a slot terminated. It can only do that between requests, so nothing
+// of it is parked.
+void loadControlExit(int slot) {
+  if (loadSlotStates[slot] == SLOT_SUSPENDED) loadSuspendedCount--;
+  else if (loadSlotStates[slot] == SLOT_ACTIVE) loadActiveCount--;
+  loadSlotStates[slot] = SLOT_EMPTY;
+}
+
+// Count one reference served for a slot
+void loadControlAccess(int slot, bool fault) {
+  loadReferences[slot]++;
+  loadReferenceTotal++;
+  if (fault) {
+    loadFaults[slot]++;
+    loadFaultTotal++;
+  }
+}
+
+// Decide, every LOAD_CHECK_NANOS, whether to swap a process out or bring one back, and
+// start counting afresh. A process is brought back regardless of the fault rate when
+// every other process is gone, and the last running process is never swapped out.
+LoadDecision checkLoad(const FrameTable* frameTable, int* slot, int* faultPercent) {
+  int percent = loadReferenceTotal > 0 ? (int)(100LL * loadFaultTotal / loadReferenceTotal) : 0;
+  LoadDecision decision = LOAD_STEADY;
+  int i;
+
+  if (loadSuspendedCount > 0 && (loadActiveCount == 0 || (loadReferenceTotal > 0 && percent < loadControlConfig.low))) {
+    // Bring back the process that has been out longest
+    for (i = 0; i < loadSlotCount; i++) {
+      if (loadSlotStates[i] != SLOT_SUSPENDED) continue;
+      if (decision == LOAD_STEADY || loadSuspendOrder[i] < loadSuspendOrder[*slot]) *slot = i;
+      decision = LOAD_RESUME;
+    }
+  } else if (loadReferenceTotal > 0 && percent > loadControlConfig.high && loadActiveCount > 1 &&
+    frameTable->freeCount <= frameTable->frameCount / LOAD_FREE_FRACTION) {
+    // Swap out the process with the highest fault rate
+    for (i = 0; i < loadSlotCount; i++) {
+      if (loadSlotStates[i] != SLOT_ACTIVE || loadReferences[i] == 0) continue;
+      if (decision == LOAD_STEADY ||
+        (long long)loadFaults[i] * loadReferences[*slot] > (long long)loadFaults[*slot] * loadReferences[i]) {
+        *slot = i;
+      }
+      decision = LOAD_SUSPEND;
+    }
+  }
+
+  for (i = 0; i < loadSlotCount; i++) {
+    loadReferences[i] = 0;
+    loadFaults[i] = 0;
+  }
+  loadReferenceTotal = 0;
+  loadFaultTotal = 0;
+  loadLastPercent = percent;
+  *faultPercent = percent;
+  return decision;
+}
+
+// Swap out the process in a slot: its pages leave memory and it is held until it is
+// resumed. Returns the number of dirty pages that have to be written out, and sets
+// freed to the number of frames given back. Shared pages other processes still map
+// stay in memory, and are never dirty.
+int suspendProcess(FrameTable* frameTable, PageTable* pageTables, int slot, int* freed) {
+  int dirty = 0;
+  int frame;
+  for (frame = 0; frame < frameTable->frameCount; frame++) {
+    if (frameTable->owners[frame].process == slot && frameBit(frameTable->dirty, frame)) dirty++;
+  }
+
+  int freeBefore = frameTable->freeCount;
+  removeProcessPages(frameTable, pageTables, slot);
+  *freed = frameTable->freeCount - freeBefore;
+  if (prefetchEnabled()) prefetchProcessRemoved(slot);
+
+  loadSlotStates[slot] = SLOT_SUSPENDED;
+  loadSuspendOrder[slot] = loadSuspensions++;
+  loadActiveCount--;
+  loadSuspendedCount++;
+  return dirty;
+}
+
+bool processSuspended(int slot) {
+  return loadSlotStates != NULL && loadSlotStates[slot] == SLOT_SUSPENDED;
+}
+
+// New processes wait while any process is swapped out or the last check found the
+// system thrashing
+bool loadControlHoldsLaunches() {
+  return loadSlotStates != NULL && (loadSuspendedCount > 0 || loadLastPercent > loadControlConfig.high);
+}
+
+// Processes that will send nothing until oss answers a request it is holding
+int parkedProcesses() {
+  return loadSlotStates != NULL ? loadParkedCount : 0;
+}
+
+// A swapped-out process sent a request; keep it until the process is resumed
+void parkRequest(int slot, const MemoryRequest* request) {
+  loadParkedRequests[slot] = *request;
+  loadParkStates[slot] = PARK_REQUEST;
+  loadParkedCount++;
+}
+
+// The fault a swapped-out process was blocked on is done; hold the reply back
+void parkReply(int slot) {
+  loadParkStates[slot] = PARK_REPLY;
+  loadParkedCount++;
+}
+
+// Let the process in a slot run again. Returns true if the reply to its last fault was
+// held back and has to be sent now; a parked request is handed out by
+// takeResumedRequest() instead.
+bool resumeProcess(int slot) {
+  loadSlotStates[slot] = SLOT_ACTIVE;
+  loadSuspendedCount--;
+  loadActiveCount++;
+
+  ParkState parked = loadParkStates[slot];
+  if (parked == PARK_REPLY) {
+    loadParkStates[slot] = PARK_NONE;
+    loadParkedCount--;
+    return true;
+  }
+  if (parked == PARK_REQUEST) {
+    loadParkStates[slot] = PARK_READY;
+    loadReadyCount++;
+  }
+  return false;
+}
+
+// Hand out a request that was parked while its process was out, if a resumed process
+// has one waiting
+bool takeResumedRequest(MemoryRequest* request, int* slot) {
+  if (loadSlotStates == NULL || loadReadyCount == 0) return false;
+
+  int i;
+  for (i = 0; i < loadSlotCount; i++) {
+    if (loadParkStates[i] != PARK_READY) continue;
+    *request = loadParkedRequests[i];
+    *slot = i;
+    loadParkStates[i] = PARK_NONE;
+    loadParkedCount--;
+    loadReadyCount--;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,52 @@
+#ifndef LOADCTL_H
+#define LOADCTL_H
+
+#include <stdbool.h>
+
+#include "structs.h"
+
+// Simulated time between looks at the fault rate
+#define LOAD_CHECK_NANOS 100000000
+// Processes faulting in their first pages while more than 1 / LOAD_FREE_FRACTION of the
+// frames are still free aren't thrashing, so nothing is swapped out then
+#define LOAD_FREE_FRACTION 8
+
+// Page-fault-frequency load control. Every LOAD_CHECK_NANOS the share of references that
+// faulted is compared with the thresholds, in percent: above high one process is swapped
+// out, below low one is brought back. high is 0 when load control is off.
+typedef struct {
+  int low;
+  int high;
+} LoadControlConfig;
+
+// What the check decided
+typedef enum {
+  LOAD_STEADY,
+  LOAD_SUSPEND, // swap out the process in the slot
+  LOAD_RESUME   // let the process in the slot run again
+} LoadDecision;
+
+extern LoadControlConfig loadControlConfig;
+
+bool parseLoadControlConfig(const char* text, LoadControlConfig* config);
+bool checkLoadControlConfig(const LoadControlConfig* config);
+
+bool initLoadControl(int processCount);
+void freeLoadControl();
+bool loadControlEnabled();
+
+void loadControlLaunch(int slot);
+void loadControlExit(int slot);
+void loadControlAccess(int slot, bool fault);
+LoadDecision checkLoad(const FrameTable* frameTable, int* slot, int* faultPercent);
+
+int suspendProcess(FrameTable* frameTable, PageTable* pageTables, int slot, int* freed);
+bool processSuspended(int slot);
+bool loadControlHoldsLaunches();
+int parkedProcesses();
+void parkRequest(int slot, const MemoryRequest* request);
+void parkReply(int slot);
+bool resumeProcess(int slot);
+bool takeResumedRequest(MemoryRequest* request, int* slot);
+
+#endif /* LOADCTL_H */
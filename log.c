@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "log.h"
+
+// Records held in memory between the main loop and the writer thread; must be a power of two
+#define LOG_RING_SIZE (1 << 16)
+// Records held for each parallel worker; also a power of two
+#define LOG_WORKER_RING_SIZE (1 << 14)
+// The writer waits for at least this many records before writing, unless the log goes quiet
+#define LOG_CHUNK_RECORDS 4096
+// Milliseconds the writer waits for a full chunk before writing what it has
+#define LOG_FLUSH_MS 10
+
+int logVerbosity = LOG_LEVEL_FRAMES;
+
+const uint8_t logLevels[LOG_TYPE_COUNT] = {
+  LOG_LEVEL_INFO,     // LOG_LAUNCH
+  LOG_LEVEL_INFO,     // LOG_TERMINATE
+  LOG_LEVEL_REQUESTS, // LOG_REQUEST
+  LOG_LEVEL_REQUESTS, // LOG_FAULT
+  LOG_LEVEL_REQUESTS, // LOG_HIT_READ
+  LOG_LEVEL_REQUESTS, // LOG_HIT_WRITE
+  LOG_LEVEL_FRAMES,   // LOG_FRAME_HEADER
+  LOG_LEVEL_FRAMES,   // LOG_FRAME_ROW
+  LOG_LEVEL_REQUESTS, // LOG_PAGEOUT
+  LOG_LEVEL_REQUESTS, // LOG_PREFETCH
+  LOG_LEVEL_REQUESTS, // LOG_ZSWAP_LOAD
+  LOG_LEVEL_INFO,     // LOG_SUSPEND
+  LOG_LEVEL_INFO,     // LOG_RESUME
+  LOG_LEVEL_REQUESTS  // LOG_COPY
+};
+
+// Single-producer/single-consumer ring: one thread appends at tail, the writer thread
+// writes records out from head
+typedef struct {
+  LogRecord* records;
+  unsigned int size;
+  _Atomic unsigned int head;
+  _Atomic unsigned int tail;
+} LogRing;
+
+// One ring per thread that logs, so parallel workers never wait on each other to log:
+// ring 0 is the main loop's and ring i + 1 is parallel worker i's. The writer merges
+// them into the file a chunk at a time, so each thread's records stay in order but
+// different threads' records are interleaved in chunks.
+LogRing logRings[1 + LOG_MAX_WORKERS];
+_Atomic int logRingCount;
+_Thread_local int logProducer;
+_Atomic bool logRunning;
+pthread_t logThread;
+int logFd = -1;
+bool logShared;
+
+// Write every record waiting in a ring to the log file, straight out of the ring
+void drainLogRing(LogRing* ring) {
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  unsigned int available = atomic_load_explicit(&ring->tail, memory_order_acquire) - head;
+  while (available > 0) {
+    // Up to the ring's wrap point at a time
+    unsigned int start = head & (ring->size - 1);
+    unsigned int count = available < ring->size - start ? available : ring->size - start;
+    const char* data = (const char*)&ring->records[start];
+    size_t remaining = count * sizeof(LogRecord);
+    while (remaining > 0) {
+      ssize_t written = write(logFd, data, remaining);
+      if (written == -1) {
+        perror("write");
+        break;
+      }
+      data += written;
+      remaining -= written;
+    }
+
+    head += count;
+    available -= count;
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+  }
+}
+
+// Write records from the rings to the log file in large chunks until the log is closed
+void* logWriter(void* arg) {
+  (void)arg;
+  int waited = 0;
+
+  while (true) {
+    // Read before the tails, so no record appended before the log was closed is missed
+    bool running = atomic_load(&logRunning);
+    int ringCount = atomic_load_explicit(&logRingCount, memory_order_acquire);
+    unsigned int available = 0;
+    int i;
+    for (i = 0; i < ringCount; i++) {
+      available += atomic_load_explicit(&logRings[i].tail, memory_order_acquire) -
+        atomic_load_explicit(&logRings[i].head, memory_order_relaxed);
+    }
+
+    if (available == 0 && !running) break;
+    if (available == 0 || (available < LOG_CHUNK_RECORDS && running && waited < LOG_FLUSH_MS)) {
+      usleep(1000);
+      waited++;
+      continue;
+    }
+
+    for (i = 0; i < ringCount; i++) {
+      drainLogRing(&logRings[i]);
+    }
+    waited = 0;
+  }
+  return NULL;
+}
+
+// Give a ring its records and empty it
+bool initLogRing(LogRing* ring, unsigned int size) {
+  ring->records = malloc(sizeof(LogRecord) * size);
+  if (ring->records == NULL) {
+    perror("malloc");
+    return false;
+  }
+  ring->size = size;
+  atomic_store(&ring->head, 0);
+  atomic_store(&ring->tail, 0);
+  return true;
+}
+
+// Set the verbosity and, if path isn't NULL, send records to a binary log file written by
+// a background thread. Without a file, records are printed to stdout as text immediately.
+bool openLog(const char* path, int verbosity) {
+  logVerbosity = verbosity;
+  if (path == NULL) return true;
+
+  logFd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (logFd == -1) {
+    perror("open");
+    return false;
+  }
+
+  LogHeader header;
+  header.magic = LOG_MAGIC;
+  header.version = LOG_VERSION;
+  header.recordSize = LOG_RECORD_SIZE;
+  if (write(logFd, &header, sizeof(header)) != sizeof(header)) {
+    perror("write");
+    return false;
+  }
+
+  if (!initLogRing(&logRings[0], LOG_RING_SIZE)) {
+    return false;
+  }
+  atomic_store(&logRingCount, 1);
+  atomic_store(&logRunning, true);
+  if (pthread_create(&logThread, NULL, logWriter, NULL) != 0) {
+    perror("pthread_create");
+    return false;
+  }
+  return true;
+}
+
+// Write out everything still in the ring and stop the writer thread
+void closeLog() {
+  if (logFd == -1) {
+    fflush(stdout);
+    return;
+  }
+
+  atomic_store(&logRunning, false);
+  pthread_join(logThread, NULL);
+  close(logFd);
+  logFd = -1;
+
+  // Workers still running when oss is interrupted may be writing to their rings, so
+  // those are left for the exit to reclaim
+  if (logShared) return;
+  free(logRings[0].records);
+  logRings[0].records = NULL;
+  atomic_store(&logRingCount, 0);
+}
+
+// Give each of workerCount parallel workers its own ring, before they start. Each
+// worker then calls attachLog with its index.
+bool shareLog(int workerCount) {
+  logShared = true;
+  if (logFd == -1) return true;
+
+  int i;
+  for (i = 1; i <= workerCount; i++) {
+    if (!initLogRing(&logRings[i], LOG_WORKER_RING_SIZE)) {
+      return false;
+    }
+  }
+  atomic_store_explicit(&logRingCount, 1 + workerCount, memory_order_release);
+  return true;
+}
+
+// Send the calling worker thread's records to its own ring
+void attachLog(int worker) {
+  logProducer = worker + 1;
+}
+
+void writeLogRecord(LogType type, const sclock_t* clock, long long a, long long b, long long c) {
+  LogRecord record;
+  memset(&record, 0, sizeof(record));
+  record.type = type;
+  record.seconds = clock->seconds;
+  record.nanoseconds = clock->nanoseconds;
+  record.a = a;
+  record.b = b;
+  record.c = c;
+
+  if (logFd == -1) {
+    // Keep the lines of one record together when several threads print
+    flockfile(stdout);
+    formatLogRecord(stdout, &record);
+    funlockfile(stdout);
+    return;
+  }
+
+  LogRing* ring = &logRings[logProducer];
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  // Wait for the writer if the ring is full rather than lose records
+  while (tail - atomic_load_explicit(&ring->head, memory_order_acquire) == ring->size) {
+    sched_yield();
+  }
+  ring->records[tail & (ring->size - 1)] = record;
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+// Log the occupied frames of the frame table
+void logFrameTable(const FrameTable* frameTable, const sclock_t* clock) {
+  if (logLevels[LOG_FRAME_HEADER] > logVerbosity) return;
+
+  writeLogRecord(LOG_FRAME_HEADER, clock, 0, 0, 0);
+  int i;
+  for (i = 0; i < frameTable->frameCount; i++) {
+    if (!frameBit(frameTable->freeFrames, i)) {
+      writeLogRecord(LOG_FRAME_ROW, clock, i, frameBit(frameTable->dirty, i), frameBit(frameTable->referenced, i));
+    }
+  }
+}
+
+// Print a record as the text oss has always written to stdout
+void formatLogRecord(FILE* out, const LogRecord* record) {
+  switch (record->type) {
+  case LOG_LAUNCH:
+    fprintf(out, "Process %lld launched at %u:%u\n", (long long)record->a, record->seconds, record->nanoseconds);
+    break;
+  case LOG_TERMINATE:
+    fprintf(out, "Process %lld terminated\n", (long long)record->a);
+    break;
+  case LOG_REQUEST:
+    fprintf(out, "Process %lld requesting %s of address %lld at time %u:%u\n", (long long)record->a, record->b ? "read" : "write", (long long)record->c, record->seconds, record->nanoseconds);
+    break;
+  case LOG_FAULT:
+    fprintf(out, "Address %lld is not in a frame, pagefault\n", (long long)record->a);
+    break;
+  case LOG_HIT_READ:
+    fprintf(out, "Address %lld in frame %lld Giving data to Process %lld at time %u:%u\n", (long long)record->a, (long long)record->b, (long long)record->c, record->seconds, record->nanoseconds);
+    break;
+  case LOG_HIT_WRITE:
+    fprintf(out, "Address %lld in frame %lld writing data to frame at time %u:%u\n", (long long)record->a, (long long)record->b, record->seconds, record->nanoseconds);
+    fprintf(out, "Dirty bit of frame %lld set, adding additional time to the clock\n", (long long)record->b);
+    break;
+  case LOG_FRAME_HEADER:
+    fprintf(out, "Current memory layout at time %u:%u is:\n", record->seconds, record->nanoseconds);
+    fprintf(out, "              Occupied  Dirty Bit  Reference Bit\n");
+    fprintf(out, "----------------------------------------------\n");
+    break;
+  case LOG_FRAME_ROW:
+    fprintf(out, "%-13lld %-9s %-9lld %-13lld\n", (long long)record->a, "Yes", (long long)record->b, (long long)record->c);
+    break;
+  case LOG_PAGEOUT:
+    fprintf(out, "Page-out daemon freed %lld frames and is writing back %lld dirty pages in %lld I/Os at time %u:%u\n", (long long)record->a, (long long)record->b, (long long)record->c, record->seconds, record->nanoseconds);
+    break;
+  case LOG_PREFETCH:
+    fprintf(out, "Read %lld pages ahead of the fault on address %lld, displacing %lld, at time %u:%u\n", (long long)record->b, (long long)record->a, (long long)record->c, record->seconds, record->nanoseconds);
+    break;
+  case LOG_ZSWAP_LOAD:
+    fprintf(out, "Address %lld decompressed from the compressed pool into frame %lld at time %u:%u\n", (long long)record->a, (long long)record->b, record->seconds, record->nanoseconds);
+    break;
+  case LOG_SUSPEND:
+    fprintf(out, "Process %lld swapped out with %lld%% of references faulting, freeing %lld frames, at time %u:%u\n", (long long)record->a, (long long)record->b, (long long)record->c, record->seconds, record->nanoseconds);
+    break;
+  case LOG_RESUME:
+    fprintf(out, "Process %lld resumed with %lld%% of references faulting at time %u:%u\n", (long long)record->a, (long long)record->b, record->seconds, record->nanoseconds);
+    break;
+  case LOG_COPY:
+    fprintf(out, "Address %lld is in a shared page, copying it into frame %lld for Process %lld at time %u:%u\n", (long long)record->a, (long long)record->b, (long long)record->c, record->seconds, record->nanoseconds);
+    break;
+  default:
+    fprintf(out, "Unknown log record type %d\n", record->type);
+    break;
+  }
+}
@@ -0,0 +1,79 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "structs.h"
+
+#define LOG_MAGIC 0x474f4c53534fULL // "OSSLOG"
+#define LOG_VERSION 2
+
+// Most parallel workers that can log, each to its own ring
+#define LOG_MAX_WORKERS 64
+
+// Verbosity levels; each level includes everything below it
+typedef enum {
+  LOG_LEVEL_QUIET = 0,
+  LOG_LEVEL_INFO = 1,     // process launches and terminations
+  LOG_LEVEL_REQUESTS = 2, // every memory request and how it was served
+  LOG_LEVEL_FRAMES = 3    // periodic frame table dumps
+} LogLevel;
+
+typedef enum {
+  LOG_LAUNCH,       // a = launch number
+  LOG_TERMINATE,    // a = pid
+  LOG_REQUEST,      // a = pid, b = isRead, c = address
+  LOG_FAULT,        // a = address
+  LOG_HIT_READ,     // a = address, b = frame, c = pid
+  LOG_HIT_WRITE,    // a = address, b = frame
+  LOG_FRAME_HEADER, // start of a frame table dump
+  LOG_FRAME_ROW,    // a = frame, b = dirty bit, c = reference byte
+  LOG_PAGEOUT,      // a = clean frames freed, b = dirty pages queued, c = write I/Os
+  LOG_PREFETCH,     // a = faulting address, b = pages read ahead, c = pages they displaced
+  LOG_ZSWAP_LOAD,   // a = faulting address, b = frame
+  LOG_SUSPEND,      // a = pid, b = fault percentage, c = frames freed
+  LOG_RESUME,       // a = pid, b = fault percentage
+  LOG_COPY,         // a = address, b = frame, c = pid
+  LOG_TYPE_COUNT
+} LogType;
+
+typedef struct {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t recordSize;
+} LogHeader;
+
+// A log record: 40 bytes on disk, the type and simulated time padded out to the 8-byte
+// alignment of the three arguments
+typedef struct {
+  uint8_t type;
+  uint8_t pad[3];
+  uint32_t seconds;
+  uint32_t nanoseconds;
+  int64_t a;
+  int64_t b;
+  int64_t c;
+} LogRecord;
+
+#define LOG_RECORD_SIZE 40
+_Static_assert(sizeof(LogRecord) == LOG_RECORD_SIZE, "log records are 40 bytes on disk");
+
+extern int logVerbosity;
+extern const uint8_t logLevels[LOG_TYPE_COUNT];
+
+bool openLog(const char* path, int verbosity);
+void closeLog();
+bool shareLog(int workerCount);
+void attachLog(int worker);
+void writeLogRecord(LogType type, const sclock_t* clock, long long a, long long b, long long c);
+void logFrameTable(const FrameTable* frameTable, const sclock_t* clock);
+void formatLogRecord(FILE* out, const LogRecord* record);
+
+// Log an event if the verbosity level includes it
+static inline void logEvent(LogType type, const sclock_t* clock, long long a, long long b, long long c) {
+  if (logLevels[type] <= logVerbosity) writeLogRecord(type, clock, a, b, c);
+}
+
+#endif /* LOG_H */
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mrc.h"
+
+// Miss ratio curves from stack distances (Mattson et al.). Each tracked page keeps the
+// time of its latest reference, and a Fenwick tree over those times counts the distinct
+// pages referenced since in O(log n). Times are renumbered from 1 whenever they reach the
+// capacity, which also drops the pages of processes that exited, so memory follows the
+// pages that are live rather than the length of the stream.
+
+// Allocate the page table, hash index and Fenwick tree for capacity pages
+bool allocateMrc(MissRatioCurve* curve, int capacity) {
+  MrcPage* pages = realloc(curve->pages, sizeof(MrcPage) * capacity);
+  int* hash = realloc(curve->hash, sizeof(int) * 2 * capacity);
+  unsigned int* tree = realloc(curve->tree, sizeof(unsigned int) * (capacity + 1));
+  if (pages != NULL) curve->pages = pages;
+  if (hash != NULL) curve->hash = hash;
+  if (tree != NULL) curve->tree = tree;
+  if (pages == NULL || hash == NULL || tree == NULL) {
+    perror("realloc");
+    return false;
+  }
+  curve->capacity = capacity;
+  curve->hashMask = 2 * capacity - 1;
+  return true;
+}
+
+bool initMissRatioCurve(MissRatioCurve* curve, int slotCount, int pageSize, int maxFrames, double rate) {
+  memset(curve, 0, sizeof(MissRatioCurve));
+  curve->pageShift = __builtin_ctz(pageSize);
+  curve->rate = rate;
+  curve->threshold = (uint64_t)(rate * (1 << 24));
+  curve->maxFrames = maxFrames;
+  curve->slotCount = slotCount;
+  curve->slotFirst = malloc(sizeof(int) * slotCount);
+  curve->slotProcess = malloc(sizeof(uint32_t) * slotCount);
+  curve->distances = calloc(maxFrames + 1, sizeof(double));
+  if (curve->slotFirst == NULL || curve->slotProcess == NULL || curve->distances == NULL) {
+    perror("malloc");
+    return false;
+  }
+  int slot;
+  for (slot = 0; slot < slotCount; slot++) {
+    curve->slotFirst[slot] = -1;
+    curve->slotProcess[slot] = curve->launched++;
+  }
+
+  if (!allocateMrc(curve, MRC_INITIAL_CAPACITY)) return false;
+  memset(curve->hash, -1, sizeof(int) * 2 * curve->capacity);
+  memset(curve->tree, 0, sizeof(unsigned int) * (curve->capacity + 1));
+  return true;
+}
+
+void freeMissRatioCurve(MissRatioCurve* curve) {
+  free(curve->pages);
+  free(curve->hash);
+  free(curve->tree);
+  free(curve->slotFirst);
+  free(curve->slotProcess);
+  free(curve->distances);
+  memset(curve, 0, sizeof(MissRatioCurve));
+}
+
+// Mix a process and page into a well-spread 64-bit hash
+uint64_t mrcHash(uint32_t process, long long page) {
+  uint64_t h = (uint64_t)page * 0x9e3779b97f4a7c15ULL ^ (uint64_t)process * 0xc2b2ae3d27d4eb4fULL;
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  return h ^ (h >> 32);
+}
+
+void treeAdd(MissRatioCurve* curve, unsigned int time, int delta) {
+  for (; time <= (unsigned int)curve->capacity; time += time & -time) {
+    curve->tree[time] += delta;
+  }
+}
+
+// Number of pages whose latest reference was at or before time
+unsigned int treeSum(const MissRatioCurve* curve, unsigned int time) {
+  unsigned int sum = 0;
+  for (; time > 0; time -= time & -time) {
+    sum += curve->tree[time];
+  }
+  return sum;
+}
+
+// Hash index slot holding a page, or the empty one where it would go
+int findMrcPage(const MissRatioCurve* curve, uint32_t process, long long page, uint64_t hash) {
+  int index = hash & curve->hashMask;
+  while (curve->hash[index] != -1) {
+    const MrcPage* entry = &curve->pages[curve->hash[index]];
+    if (entry->process == process && entry->page == page) break;
+    index = (index + 1) & curve->hashMask;
+  }
+  return index;
+}
+
+int compareMrcTimes(const void* a, const void* b) {
+  unsigned int x = ((const MrcPage*)a)->time;
+  unsigned int y = ((const MrcPage*)b)->time;
+  return x < y ? -1 : x > y;
+}
+
+// Access times ran out: drop the pages of exited processes and number the latest
+// references of the rest 1, 2, ... in order, growing the tables if they are half full
+bool renumberMrc(MissRatioCurve* curve) {
+  int live = 0;
+  int i;
+  for (i = 0; i < curve->pageCount; i++) {
+    if (curve->pages[i].time != 0) curve->pages[live++] = curve->pages[i];
+  }
+  qsort(curve->pages, live, sizeof(MrcPage), compareMrcTimes);
+
+  if (live > curve->capacity / 2 && !allocateMrc(curve, curve->capacity * 2)) return false;
+  memset(curve->hash, -1, sizeof(int) * 2 * curve->capacity);
+  memset(curve->tree, 0, sizeof(unsigned int) * (curve->capacity + 1));
+  for (i = 0; i < curve->slotCount; i++) {
+    curve->slotFirst[i] = -1;
+  }
+
+  for (i = 0; i < live; i++) {
+    MrcPage* entry = &curve->pages[i];
+    entry->time = i + 1;
+    treeAdd(curve, entry->time, 1);
+    entry->next = curve->slotFirst[entry->slot];
+    curve->slotFirst[entry->slot] = i;
+    curve->hash[findMrcPage(curve, entry->process, entry->page, mrcHash(entry->process, entry->page))] = i;
+  }
+  curve->pageCount = live;
+  curve->now = live;
+  return true;
+}
+
+// A process referenced an address. context is the MissRatioCurve, so this can be used
+// as a ReferenceSink.
+void mrcAccess(void* context, int slot, uint64_t address, bool isRead) {
+  (void)isRead;
+  MissRatioCurve* curve = (MissRatioCurve*)context;
+  curve->references++;
+
+  uint32_t process = curve->slotProcess[slot];
+  long long page = address >> curve->pageShift;
+  uint64_t hash = mrcHash(process, page);
+  if (curve->rate < 1 && hash >> 40 >= curve->threshold) return;
+  curve->sampled++;
+
+  if (curve->now == (unsigned int)curve->capacity && !renumberMrc(curve)) exit(1);
+  unsigned int now = ++curve->now;
+
+  int index = findMrcPage(curve, process, page, hash);
+  if (curve->hash[index] == -1) {
+    // First reference to the page: a miss at any size
+    curve->beyond++;
+    MrcPage* entry = &curve->pages[curve->pageCount];
+    entry->process = process;
+    entry->page = page;
+    entry->time = now;
+    entry->slot = slot;
+    entry->next = curve->slotFirst[slot];
+    curve->slotFirst[slot] = curve->pageCount;
+    curve->hash[index] = curve->pageCount++;
+  } else {
+    // Pages referenced since, plus this one, are the frames LRU needs to still hold it
+    MrcPage* entry = &curve->pages[curve->hash[index]];
+    unsigned int distance = treeSum(curve, now - 1) - treeSum(curve, entry->time) + 1;
+    double frames = distance / curve->rate;
+    if (frames > curve->maxFrames) {
+      curve->beyond++;
+    } else {
+      curve->distances[(int)(frames + 0.5)]++;
+    }
+    treeAdd(curve, entry->time, -1);
+    entry->time = now;
+  }
+  treeAdd(curve, now, 1);
+}
+
+// The process in a slot terminated: its pages no longer take up memory
+void mrcExit(void* context, int slot) {
+  MissRatioCurve* curve = (MissRatioCurve*)context;
+  int index;
+  for (index = curve->slotFirst[slot]; index != -1; index = curve->pages[index].next) {
+    MrcPage* entry = &curve->pages[index];
+    if (entry->time != 0) treeAdd(curve, entry->time, -1);
+    entry->time = 0;
+  }
+  curve->slotFirst[slot] = -1;
+  curve->slotProcess[slot] = curve->launched++;
+}
+
+// Turn the distance counts into the misses of each memory size, once the stream is over
+void finishMissRatioCurve(MissRatioCurve* curve) {
+  double misses = curve->beyond;
+  int frames;
+  for (frames = curve->maxFrames; frames >= 0; frames--) {
+    double hits = curve->distances[frames];
+    curve->distances[frames] = misses;
+    misses += hits;
+  }
+}
+
+// Fraction of references that fault in an LRU memory of frames frames. When sampling,
+// the sampled references are scaled to the expected number so sampling noise in how
+// many were taken doesn't shift the whole curve (SHARDS-adj).
+double missRatio(const MissRatioCurve* curve, int frames) {
+  double expected = curve->references * (curve->rate < 1 ? curve->rate : 1.0);
+  if (expected == 0) return 0.0;
+  if (frames > curve->maxFrames) frames = curve->maxFrames;
+  double ratio = curve->distances[frames] / expected;
+  return ratio < 1 ? ratio : 1.0;
+}
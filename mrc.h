@@ -0,0 +1,58 @@
+#ifndef MRC_H
+#define MRC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Pages a miss ratio curve tracks before renumbering its access times
+#define MRC_INITIAL_CAPACITY (1 << 16)
+
+// A page some process referenced, as the curve remembers it
+typedef struct {
+  uint32_t process;   // launch number of the process the page belongs to
+  long long page;
+  unsigned int time;  // time of its latest reference, 0 once its process has exited
+  int slot;
+  int next;           // next page of the same slot
+} MrcPage;
+
+// LRU miss ratio curve built in one pass over a reference stream. A reference's stack
+// distance is the number of distinct pages referenced since the last reference to the
+// same page, found with a Fenwick tree that holds a 1 at every page's latest access time.
+// An LRU memory of n frames hits exactly the references with a distance of at most n.
+// With a sampling rate below 1 only pages whose hash falls under the rate are tracked
+// (SHARDS), and their distances are scaled up by 1 / rate.
+typedef struct {
+  int pageShift;
+  double rate;
+  uint64_t threshold;        // pages hashing below this are sampled
+  int maxFrames;             // distances beyond this all count as misses
+
+  MrcPage* pages;
+  int pageCount;
+  int capacity;
+  int* hash;                 // open-addressed index into pages, -1 where empty
+  int hashMask;
+  unsigned int* tree;        // Fenwick tree over access times 1..capacity
+  unsigned int now;
+
+  int slotCount;
+  int* slotFirst;            // first page of the process running in each slot
+  uint32_t* slotProcess;     // launch number of the process running in each slot
+  uint32_t launched;
+
+  double* distances;         // sampled references at each distance in frames; once finished,
+                             // the misses of a memory of each number of frames
+  double beyond;             // sampled references further than maxFrames, and first references
+  unsigned long long references;
+  unsigned long long sampled;
+} MissRatioCurve;
+
+bool initMissRatioCurve(MissRatioCurve* curve, int slotCount, int pageSize, int maxFrames, double rate);
+void freeMissRatioCurve(MissRatioCurve* curve);
+void mrcAccess(void* context, int slot, uint64_t address, bool isRead);
+void mrcExit(void* context, int slot);
+void finishMissRatioCurve(MissRatioCurve* curve);
+double missRatio(const MissRatioCurve* curve, int frames);
+
+#endif /* MRC_H */
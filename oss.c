@@ -23,157 +23,231 @@
 
 #include "shared_memory.h"
 #include "structs.h"
+#include "transport.h"
+#include "events.h"
+#include "policy.h"
+#include "trace.h"
+#include "replay.h"
+#include "log.h"
+#include "stats.h"
+#include "user_threads.h"
+#include "parallel.h"
+#include "tlb.h"
+#include "pageout.h"
+#include "prefetch.h"
+#include "zswap.h"
+#include "loadctl.h"
+#include "proctable.h"
+#include "workload.h"
+
+// How long the main loop sleeps at most while parallel workers serve requests, so the
+// clock keeps up with the time they spend on hits
+#define PARALLEL_POLL_NANOS 1000000
 
 sclock_t* sclock;
 PageTable* pageTables;
 FrameTable* frameTable;
+StatsBlock* stats;
 
-int msgqid;
+Transport transport;
+TraceWriter traceWriter;
+int parallelWorkers = 1;
 
+// Set by SIGCHLD until the main loop reaps the children that exited
+volatile sig_atomic_t childExited;
+// pid of the pooled user process serving each slot, when there is a process pool
+pid_t* userPool;
 
-// This function assigns a process ID (pid) to the first available slot in the process control block (pcb).
-void assignProcess(int* pcb, int pid) {
-  int i;
-  // Iterate over the pcb array
-  for (i = 0; i < 18; i++) {
-    // If the current slot is unoccupied (-1), assign it the pid
-    if (pcb[i] == -1) {
-      pcb[i] = pid;
-      return;
-    };
-  }
-  return;
-}
 
-// This function clears the process ID (pid) from the process control block (pcb).
-void clearProcess(int* pcb, int pid) {
-  int i;
-  // Iterate over the pcb array
-  for (i = 0; i < 18; i++) {
-    // If the current slot holds the pid, clear it (-1)
-    if (pcb[i] == pid) {
-      pcb[i] = -1;
-      return;
-    }
+// Function to clean up system resources before exiting the program
+void clearEverything() {
+  // Worker or user threads still running when oss is interrupted may be using the rings
+  // and shared memory. Then the blocks are only marked for removal and stay mapped
+  // until the process exits.
+  bool threadsRunning = workersRunning() || (transport.mode == TRANSPORT_THREAD && userThreadsRunning() > 0);
+
+  // Delete the message queue or shared rings
+  if (!threadsRunning) {
+    closeTransport(&transport, true);
+  } else if (transport.mode == TRANSPORT_RING) {
+    destroy_memory_block("transport.c");
   }
-  return;
-}
 
-// This function returns the index of a given process ID (pid) in the process control block (pcb), or -1 if it is not found.
-int findProcessIndex(int* pcb, int pid) {
-  int i;
-  // Iterate over the pcb array
-  for (i = 0; i < 18; i++) {
-    // If the pid is found, return its index
-    if (pcb[i] == pid) return i;
+  // Flush the trace being recorded, if any
+  closeTraceWriter(&traceWriter);
+
+  // Write out any buffered log records
+  closeLog();
+
+  // Detach and destroy shared memory blocks
+  if (!threadsRunning) {
+    detach_memory_block((void*)sclock);
+    detach_memory_block((void*)pageTables);
+    detach_memory_block((void*)frameTable);
+  }
+  destroy_memory_block("oss.c");
+  destroy_memory_block("user_proc.c");
+  destroy_memory_block("structs.c");
+  if (threadsRunning) {
+    removeStats(stats);
+  } else {
+    detachStats(stats, true);
   }
-  return -1;
 }
 
-// This function prints all process IDs (pid) in the process control block (pcb).
-void printPIDs(int* pcb) {
-  int i;
-  // Iterate over the pcb array
-  for (i = 0; i < 18; i++) {
-    printf("%-5d ", pcb[i]); // Print each PID with a width of 5 characters
-    if ((i + 1) % 18 == 0) {
-      printf("\n"); // Print a new line after every 18 PIDs
-    }
-  }
+// Function to handle alarm signal (SIGALRM)
+void handle_alarm(int signum) {
+  printf("\nTerminating due to 2 seconds timeout.\n");
+  // Clean up system resources
+  clearEverything();
+  // Send termination signal to all processes in the current process group
+  kill(0, SIGTERM);
+  // Exit the current process
+  exit(0);
 }
 
-// This function pushes a process ID (pid) to the end of a queue.
-void pushToQueue(int* queue, int pid) {
-  int i;
-  // Iterate over the queue array
-  for (i = 0; i < 18; i++) {
-    // If the current slot is unoccupied (-1), push the pid to it
-    if (queue[i] == -1) {
-      queue[i] = pid;
-      break;
-    }
-  }
+// Function to handle child termination signal (SIGCHLD) by flagging it for the main loop
+// and waking the loop if it is asleep
+void handle_child(int signum) {
+  (void)signum;
+  int savedErrno = errno;
+  childExited = 1;
+  wakeTransport(&transport);
+  errno = savedErrno;
 }
 
-// This function removes and returns the process ID (pid) from the front of a queue.
-int popQueue(int* queue) {
-  int front = queue[0];
+// Returns true if a child has exited but hasn't been reaped yet
+bool childExitPending() {
+  if (transport.mode == TRANSPORT_THREAD) return userThreadExitPending();
+  return childExited;
+}
 
-  int i;
-  // Shift all elements of the queue to the left
-  for (i = 0; i < 17; i++) {
-    queue[i] = queue[i + 1];
+// Give back everything a terminated process held: its frames, its pages in the pool and
+// read-ahead state, and its slot
+void endProcess(int pid) {
+  int slot = clearProcess(pid);
+  if (parallelWorkers > 1) {
+    parallelLogFrameTable(sclock);
+    parallelRemoveProcessPages(slot);
+  } else {
+    logFrameTable(frameTable, sclock);
+    writeTraceRecord(&traceWriter, TRACE_EXIT, clock_to_nano(*sclock), pid, slot, 0, false);
+    removeProcessPages(frameTable, pageTables, slot);
+    clearSharedCopies(pageTables, slot);
+    if (prefetchEnabled()) prefetchProcessRemoved(slot);
+    if (zswapEnabled()) zswapProcessRemoved(slot);
+    if (loadControlEnabled()) loadControlExit(slot);
   }
-  queue[17] = -1;
-
-  return front;
+  statsTerminate(stats, slot);
+  logEvent(LOG_TERMINATE, sclock, pid, 0, 0);
 }
 
-// This function checks if a queue is empty and returns true if it is, or false if it isn't.
-bool queueIsEmpty(int* queue) {
-  if (queue[0] != -1) return false;
-  return true;
-}
+// Reap every child that has exited, or user thread that has finished, since SIGCHLD
+// last flagged one. Returns how many processes terminated.
+int reapChildren() {
+  int reaped = 0;
+  pid_t pid;
+  if (transport.mode == TRANSPORT_THREAD) {
+    while ((pid = reapUserThread()) > 0) {
+      endProcess(pid);
+      reaped++;
+    }
+    return reaped;
+  }
 
-// Function to push new blocked time into the blockedTimes array
-void pushToBlockedTimes(sclock_t* blockedTimes, int seconds, int nano) {
-  int i;
-  // Loop through the array
-  for (i = 0; i < 18; i++) {
-    // If this index is not occupied (signified by seconds == -1)
-    if (blockedTimes[i].seconds == -1) {
-      // Create a new sclock_t object with the specified time
-      sclock_t t;
-      t.seconds = seconds;
-      t.nanoseconds = nano;
-      // Put the new object into the array at the current index
-      blockedTimes[i] = t;
-      // Stop the loop after adding the new time
-      break;
+  if (!childExited) return 0;
+  childExited = 0;
+  int status;
+  while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+    // Pooled user processes only exit when oss stops the pool
+    if (userPool != NULL) {
+      fprintf(stderr, "A pooled user process exited unexpectedly\n");
+      exit(1);
     }
+    endProcess(pid);
+    reaped++;
   }
+  return reaped;
 }
 
-// Function to pop the first blocked time from the blockedTimes array
-void popBlockedTimes(sclock_t* blockedTimes) {
-  int i;
-  // Shift all elements in the array one position to the left
-  for (i = 0; i < 17; i++) {
-    blockedTimes[i] = blockedTimes[i + 1];
-  }
-  // Put a placeholder sclock_t object at the last index to signify it's not occupied
-  sclock_t t;
-  t.seconds = -1;
-  t.nanoseconds = 0;
-  blockedTimes[17] = t;
-}
+// Fork a user process into a slot. A pooled one waits for oss to start each simulated
+// process it runs; otherwise it runs one, with the given seed.
+pid_t forkUserProc(TransportMode transportMode, int slot, const PagingConfig* config, const char* workloadSpec,
+  int readPercent, uint64_t seed, int batch, bool pooled) {
+  pid_t pid = fork();
 
-// Function to clean up system resources before exiting the program
-void clearEverything() {
-  // Delete the message queue
-  if (msgctl(msgqid, IPC_RMID, NULL) == -1) {
-    perror("msgctl failed");
+  // If fork failed.
+  if (pid < 0) {
+    printf("Fork failed!\n");
     exit(1);
   }
+  // If this is the parent process.
+  if (pid > 0) return pid;
+
+  // Set the process group ID of the child process to that of the parent
+  setpgid(0, getppid());
+
+  // Execute the user process
+  char slotArg[16], pagesArg[16], pageSizeArg[16], addressBitsArg[16], readArg[16], seedArg[24], batchArg[16];
+  snprintf(slotArg, sizeof(slotArg), "%d", slot);
+  snprintf(pagesArg, sizeof(pagesArg), "%d", config->pagesPerProcess);
+  snprintf(pageSizeArg, sizeof(pageSizeArg), "%d", config->pageSize);
+  snprintf(addressBitsArg, sizeof(addressBitsArg), "%d", config->addressBits);
+  snprintf(readArg, sizeof(readArg), "%d", readPercent);
+  snprintf(seedArg, sizeof(seedArg), "%llu", (unsigned long long)seed);
+  snprintf(batchArg, sizeof(batchArg), "%d", batch);
+  char* const args[] = { "./user_proc", "-t", transportMode == TRANSPORT_RING ? "ring" : "msgq", "-s", slotArg,
+    "-g", pagesArg, "-z", pageSizeArg, "-x", addressBitsArg, "-W", (char*)workloadSpec, "-R", readArg,
+    "-k", batchArg, pooled ? "-P" : "-S", pooled ? NULL : seedArg, NULL };
+  execv("./user_proc", args);
+  exit(1);
+}
 
-  // Detach and destroy shared memory blocks
-  detach_memory_block((void*)sclock);
-  destroy_memory_block("oss.c");
-  detach_memory_block((void*)pageTables);
-  destroy_memory_block("user_proc.c");
-  detach_memory_block((void*)frameTable);
-  destroy_memory_block("structs.c");
+// Called when the main loop has no request to serve. If some running process isn't
+// blocked, sleeps until it sends a request or a child exits. Otherwise nothing can
+// arrive before the next scheduled event, so the clock jumps straight to it.
+// Returns true if a request arrived.
+bool waitForEvent(MemoryRequest* request, int* slot, EventQueue* events, int runningChildren,
+  int blockedChildren, bool launchDue, bool canLaunch) {
+  unsigned int ticket = prepareWait(&transport);
+  bool exitPending = childExitPending();
+
+  // There is a process to launch or reap right now
+  if ((launchDue && canLaunch) || exitPending) {
+    cancelWait(&transport);
+    return false;
+  }
+
+  if (runningChildren > blockedChildren) {
+    return waitForRequest(&transport, ticket, request, slot);
+  }
+
+  Event next;
+  unsigned long long now = clock_to_nano(*sclock);
+  if (peekEvent(events, &next) && next.time > now) {
+    increment_clock(sclock, next.time - now);
+  }
+  cancelWait(&transport);
+  return false;
 }
 
-// Function to handle alarm signal (SIGALRM)
-void handle_alarm(int signum) {
-  printf("\nTerminating due to 2 seconds timeout.\n");
-  // Clean up system resources
-  clearEverything();
-  // Send termination signal to all processes in the current process group
-  kill(0, SIGTERM);
-  // Exit the current process
-  exit(0);
+// Parallel counterpart of waitForEvent. The workers serve requests themselves, so the
+// main loop only waits for them to report a fault, a child to exit or the poll timeout.
+void waitForWorkersOrEvent(EventQueue* events, int runningChildren, int blockedChildren, bool launchDue,
+  bool canLaunch) {
+  // There is a process to launch or reap right now
+  if ((launchDue && canLaunch) || childExitPending()) return;
+
+  if (runningChildren > blockedChildren) {
+    waitForWorkers(PARALLEL_POLL_NANOS);
+    return;
+  }
+
+  Event next;
+  unsigned long long now = clock_to_nano(*sclock);
+  if (peekEvent(events, &next) && next.time > now) {
+    increment_clock(sclock, next.time - now);
+  }
 }
 
 // Function to handle interrupt signal (SIGINT, triggered by CTRL-C)
@@ -187,7 +261,263 @@ void handle_interrupt(int signum) {
   exit(0);
 }
 
+// Print command-line usage
+void printUsage(const char* program) {
+  printf("Usage: %s [-h] [-t msgq|ring|thread] [-p policy] [-w trace | -r trace] [-l logfile] [-v level]\n", program);
+  printf("          [-c processes] [-n total] [-g pages] [-f frames] [-z page size] [-j workers]\n");
+  printf("          [-x address bits] [-H] [-s shared pages] [-b tlb entries] [-a tlb ways]\n");
+  printf("          [-e lru|fifo|random]\n");
+  printf("          [-o low,high] [-A window] [-Z pool] [-L low,high] [-W workload] [-R read percent]\n");
+  printf("          [-S seed] [-k batch] [-P]\n");
+  printf("  -t  transport between oss and user processes (default msgq); thread runs the user\n");
+  printf("      processes as threads inside oss instead of forking them\n");
+  printf("  -p  page replacement policy: %s (default clock)\n", replacementPolicyNames());
+  printf("  -w  record every memory reference to a binary trace file\n");
+  printf("  -r  replay a recorded trace through the paging engine and exit\n");
+  printf("  -l  write a binary log from a background thread instead of text on stdout (decode with osslog)\n");
+  printf("  -v  verbosity: 0 quiet, 1 launches/terminations, 2 requests, 3 frame tables (default 3)\n");
+  printf("  -c  process slots that can run at once (default %d)\n", DEFAULT_PROCESS_COUNT);
+  printf("  -n  processes to launch in total (default 100)\n");
+  printf("  -g  pages in each process's address space (default %d)\n", DEFAULT_PAGES_PER_PROCESS);
+  printf("  -f  frames of physical memory (default %d)\n", DEFAULT_FRAME_COUNT);
+  printf("  -z  page size in bytes, a power of two (default %d)\n", DEFAULT_PAGE_SIZE);
+  printf("  -x  bits of each process's virtual address space, up to %d; its pages are spread\n", MAX_ADDRESS_BITS);
+  printf("      over it in clusters (default: just enough bits for -g pages)\n");
+  printf("  -H  fault in huge pages, a whole leaf page table node's worth of frames at once\n");
+  printf("  -s  share each process's first pages with every other process; a write gives the\n");
+  printf("      writer its own copy (default 0)\n");
+  printf("  -j  worker threads serving requests in parallel (default 1; needs -t ring or thread)\n");
+  printf("  -b  TLB entries per process, a power of two or 0 for no TLB (default %d)\n", DEFAULT_TLB_ENTRIES);
+  printf("  -a  TLB associativity, a power of two up to the entries (default %d)\n", DEFAULT_TLB_WAYS);
+  printf("  -e  TLB replacement policy (default lru)\n");
+  printf("  -o  run the page-out daemon, keeping between low and high frames free\n");
+  printf("  -A  read up to this many pages ahead of faults that continue a sequential or\n");
+  printf("      strided scan, in the same disk read (default 0, off)\n");
+  printf("  -Z  compress evicted pages into a pool of frames[:ratio[:spread]] before they go to\n");
+  printf("      disk; each page compresses by ratio +- spread (default %.0f +- %.0f, pool off)\n",
+    DEFAULT_ZSWAP_RATIO, DEFAULT_ZSWAP_SPREAD);
+  printf("  -L  swap out the process faulting most while more than high percent of references\n");
+  printf("      fault, and bring one back once fewer than low percent do (default off)\n");
+  printf("  -W  references of each user process: uniform (default), zipf[:theta], scan,\n");
+  printf("      loop[:pages], phase[:pages[:length]] or mix[:scan percent[:theta]]\n");
+  printf("  -R  percentage of references that are reads (default %d)\n", DEFAULT_READ_PERCENT);
+  printf("  -S  seed the user processes' workloads derive their seeds from (default: the time)\n");
+  printf("  -k  memory references in each request, up to %d (default 1)\n", MAX_REQUEST_BATCH);
+  printf("  -P  fork one user process per slot up front and have it run simulated process after\n");
+  printf("      simulated process, instead of forking one for each\n");
+}
+
 int main(int argc, char const* argv[]) {
+  TransportMode transportMode = TRANSPORT_MSGQ;
+  const char* recordPath = NULL;
+  const char* replayPath = NULL;
+  const char* logPath = NULL;
+  int verbosity = LOG_LEVEL_FRAMES;
+  int total_processes = 100;
+  PagingConfig config;
+  defaultPagingConfig(&config);
+  bool framesGiven = false;
+  const char* workloadSpec = "uniform";
+  WorkloadConfig workload;
+  defaultWorkloadConfig(&workload);
+  uint64_t runSeed = time(NULL);
+  int batch = 1;
+  bool pooled = false;
+
+  int opt;
+  while ((opt = getopt(argc, (char* const*)argv, "ht:p:w:r:l:v:c:n:g:f:z:x:Hs:j:b:a:e:o:A:Z:L:W:R:S:k:P")) != -1) {
+    switch (opt) {
+    case 't':
+      if (!parseTransportMode(optarg, &transportMode)) {
+        printUsage(argv[0]);
+        exit(1);
+      }
+      break;
+    case 'p':
+      if (!selectReplacementPolicy(optarg)) {
+        printUsage(argv[0]);
+        exit(1);
+      }
+      break;
+    case 'w':
+      recordPath = optarg;
+      break;
+    case 'r':
+      replayPath = optarg;
+      break;
+    case 'l':
+      logPath = optarg;
+      break;
+    case 'v':
+      verbosity = atoi(optarg);
+      break;
+    case 'c':
+      config.processCount = atoi(optarg);
+      break;
+    case 'n':
+      total_processes = atoi(optarg);
+      break;
+    case 'g':
+      config.pagesPerProcess = atoi(optarg);
+      break;
+    case 'f':
+      config.frameCount = atoi(optarg);
+      framesGiven = true;
+      break;
+    case 'z':
+      config.pageSize = atoi(optarg);
+      break;
+    case 'x':
+      config.addressBits = atoi(optarg);
+      break;
+    case 'H':
+      config.hugePages = true;
+      break;
+    case 's':
+      config.sharedPages = atoi(optarg);
+      break;
+    case 'j':
+      parallelWorkers = atoi(optarg);
+      break;
+    case 'b':
+      tlbConfig.entries = atoi(optarg);
+      break;
+    case 'a':
+      tlbConfig.ways = atoi(optarg);
+      break;
+    case 'e':
+      if (!parseTlbReplacement(optarg, &tlbConfig.replacement)) {
+        printUsage(argv[0]);
+        exit(1);
+      }
+      break;
+    case 'o':
+      if (!parsePageOutConfig(optarg, &pageOutConfig)) {
+        printUsage(argv[0]);
+        exit(1);
+      }
+      break;
+    case 'A':
+      prefetchConfig.window = atoi(optarg);
+      break;
+    case 'Z':
+      if (!parseZswapConfig(optarg, &zswapConfig)) {
+        printUsage(argv[0]);
+        exit(1);
+      }
+      break;
+    case 'L':
+      if (!parseLoadControlConfig(optarg, &loadControlConfig)) {
+        printUsage(argv[0]);
+        exit(1);
+      }
+      break;
+    case 'W':
+      if (!parseWorkload(optarg, &workload)) {
+        printUsage(argv[0]);
+        exit(1);
+      }
+      workloadSpec = optarg;
+      break;
+    case 'R':
+      workload.readPercent = atoi(optarg);
+      break;
+    case 'S':
+      runSeed = strtoull(optarg, NULL, 10);
+      break;
+    case 'k':
+      batch = atoi(optarg);
+      break;
+    case 'P':
+      pooled = true;
+      break;
+    case 'h':
+      printUsage(argv[0]);
+      exit(0);
+    default:
+      printUsage(argv[0]);
+      exit(1);
+    }
+  }
+
+  // A TLB smaller than the default is still asked for with -b alone
+  if (tlbConfig.ways > tlbConfig.entries && tlbConfig.entries > 0) tlbConfig.ways = tlbConfig.entries;
+  if (!checkTlbConfig(&tlbConfig)) {
+    exit(1);
+  }
+
+  // Replaying a trace needs no user processes, shared memory or IPC. The trace says how
+  // big the system was, though -f can still change the number of frames and -H turn on
+  // huge pages.
+  if (replayPath != NULL) {
+    return replayTrace(replayPath, framesGiven ? config.frameCount : 0, config.hugePages);
+  }
+
+  // Live processes have no future to look ahead in
+  if (replacementPolicy == &optPolicy) {
+    fprintf(stderr, "The opt policy can only replay a trace (-r)\n");
+    exit(1);
+  }
+
+  if (config.addressBits == 0) config.addressBits = denseAddressBits(&config);
+  if (!checkPagingConfig(&config) || !checkPageOutConfig(&pageOutConfig, config.frameCount) ||
+    !checkPrefetchConfig(&prefetchConfig, &config) || !checkZswapConfig(&zswapConfig) ||
+    !checkLoadControlConfig(&loadControlConfig) || !checkWorkloadConfig(&workload, config.pagesPerProcess)) {
+    exit(1);
+  }
+  // The page-out daemon writes its victims straight to disk, around the pool
+  if (zswapConfig.frames > 0 && pageOutConfig.high > 0) {
+    fprintf(stderr, "The compressed pool (-Z) can't be used with the page-out daemon (-o)\n");
+    exit(1);
+  }
+  // Replay has no page-out daemon, so a trace couldn't reproduce its evictions and writes
+  if (pageOutConfig.high > 0 && recordPath != NULL) {
+    fprintf(stderr, "The page-out daemon (-o) can't be used while recording a trace (-w)\n");
+    exit(1);
+  }
+  // Swapping a process out isn't a reference or an exit, so a trace couldn't replay it
+  if (loadControlConfig.high > 0 && recordPath != NULL) {
+    fprintf(stderr, "Load control (-L) can't be used while recording a trace (-w)\n");
+    exit(1);
+  }
+
+  if (batch < 1 || batch > MAX_REQUEST_BATCH) {
+    fprintf(stderr, "A request carries between 1 and %d references\n", MAX_REQUEST_BATCH);
+    exit(1);
+  }
+  // User threads are started inside oss and cost no fork to begin with
+  if (pooled && transportMode == TRANSPORT_THREAD) {
+    fprintf(stderr, "The process pool (-P) can't be used with -t thread\n");
+    exit(1);
+  }
+  if (parallelWorkers < 1 || parallelWorkers > MAX_WORKERS) {
+    fprintf(stderr, "The number of workers must be between 1 and %d\n", MAX_WORKERS);
+    exit(1);
+  }
+  if (parallelWorkers > 1) {
+    // Workers serve their own share of the per-slot rings with per-shard CLOCK hands,
+    // and their references don't happen in one order a trace could record. They evict
+    // inline, so there is no page-out daemon either.
+    if (transportMode == TRANSPORT_MSGQ || replacementPolicy != &clockPolicy || recordPath != NULL || config.hugePages ||
+      config.sharedPages > 0 || pageOutConfig.high > 0 || prefetchConfig.window > 0 || zswapConfig.frames > 0 || loadControlConfig.high > 0 ||
+      pooled) {
+      fprintf(stderr, "Parallel workers need -t ring or -t thread, the clock policy, and no -w, -H, -s, -o, -A, -Z, -L or -P\n");
+      exit(1);
+    }
+    // A worker without a process slot would have nothing to do
+    if (parallelWorkers > config.processCount) parallelWorkers = config.processCount;
+    // The TLBs belong to the serial engine; workers always walk the page tables
+    tlbConfig.entries = 0;
+  }
+
+  if (recordPath != NULL && !openTraceWriter(&traceWriter, recordPath, &config)) {
+    exit(1);
+  }
+
+  if (!openLog(logPath, verbosity)) {
+    exit(1);
+  }
+
   // Make the main process the group leader
   setpgid(0, 0);
 
@@ -204,66 +534,100 @@ int main(int argc, char const* argv[]) {
   sclock->nanoseconds = 0;
 
   // Attach shared memory block for page tables
-  pageTables = (PageTable*)attach_memory_block("user_proc.c", sizeof(PageTable) * 18);
-  initializePageTables(pageTables);
+  pageTables = (PageTable*)attach_memory_block("user_proc.c", pageTablesSize(&config));
 
   // Attach shared memory block for frame table
-  frameTable = (FrameTable*)attach_memory_block("structs.c", sizeof(FrameTable));
-  initializeFrameTable(frameTable);
+  frameTable = (FrameTable*)attach_memory_block("structs.c", frameTableSize(config.frameCount));
+  if (pageTables == NULL || frameTable == NULL) {
+    perror("attach_memory_block");
+    exit(1);
+  }
 
-  int max_processes = 18;
-  int total_processes = 100;
+  // Attach shared memory block for statistics read by ossstat
+  stats = attachStats(config.processCount);
+  if (stats == NULL) {
+    perror("attach_memory_block");
+    exit(1);
+  }
+  initializeStats(stats, config.processCount);
+
+  int max_processes = config.processCount;
 
   int created_children = 0;
   int running_children = 0;
 
-  sclock_t previousLaunchTime;
-  previousLaunchTime.nanoseconds = 0;
-  previousLaunchTime.seconds = 0;
+  int blocked_children = 0;
+  bool launchDue = false;
+
+  // Timed events: fault completions, process launches, frame table prints and load checks
+  EventQueue events;
+  initEventQueue(&events, 32);
 
   // Generate random gap between process launches
   srand(time(0));
   int randGap = (rand() % (500000000 - 1000000 + 1)) + 1000000;
+  scheduleEvent(&events, randGap, EVENT_LAUNCH, -1, -1);
+  scheduleEvent(&events, 500000000, EVENT_PRINT, -1, -1);
 
-  // Initialize PCB array with -1
-  int pcb[18];
-  int i;
-  for (i = 0; i < 18; i++) {
-    pcb[i] = -1;
+  // Start with every PCB slot free
+  if (!initProcessTable(max_processes)) {
+    exit(1);
   }
+  int i;
 
-  // Initialize queue array with -1
-  int queue[18];
-  for (i = 0; i < 18; i++) {
-    queue[i] = -1;
+  // The reply each blocked process gets once its page is in
+  MemoryRequest* faultReplies = malloc(sizeof(MemoryRequest) * max_processes);
+  if (faultReplies == NULL) {
+    perror("malloc");
+    exit(1);
   }
 
-  // Initialize blocked times array with -1
-  sclock_t blockedTimes[18];
-  for (i = 0; i < 18; i++) {
-    sclock_t t;
-    t.seconds = -1;
-    t.nanoseconds = 0;
-    blockedTimes[i] = t;
+  // Create the message queue or shared rings used to talk to user processes
+  if (!openTransport(&transport, transportMode, max_processes)) {
+    exit(1);
   }
 
-  // Create a message queue using IPC_CREAT flag
-  key_t key = ftok(".", 'm');
-  msgqid = msgget(key, IPC_CREAT | 0666);
-  if (msgqid == -1) {
-    perror("msgget");
+  if (transportMode == TRANSPORT_THREAD && !initUserThreads(max_processes)) {
     exit(1);
   }
 
+  // Child exits wake the main loop when it is waiting for requests
+  signal(SIGCHLD, handle_child);
+
   // Initialize page tables
-  initializePageTables(pageTables);
+  initializePageTables(pageTables, &config);
 
   // Initialize frame table
-  initializeFrameTable(frameTable);
+  initializeFrameTable(frameTable, config.frameCount);
 
-  sclock_t previousPCBPrint;
-  previousPCBPrint.seconds = 0;
-  previousPCBPrint.nanoseconds = 0;
+  // Give every process slot an empty TLB
+  if (!initTlb(max_processes)) {
+    exit(1);
+  }
+
+  if (!initPageOut(config.frameCount) || !initPrefetch(max_processes, config.frameCount) ||
+    !initZswap(max_processes, config.pageSize) || !initLoadControl(max_processes)) {
+    exit(1);
+  }
+  if (loadControlEnabled()) scheduleEvent(&events, LOAD_CHECK_NANOS, EVENT_LOAD_CHECK, -1, -1);
+
+  if (parallelWorkers > 1 && !startWorkers(parallelWorkers, &transport, frameTable, pageTables, stats)) {
+    exit(1);
+  }
+
+  // Fork the pool up front; each pooled process waits on its slot's channel for oss to
+  // start its first simulated process
+  if (pooled) {
+    userPool = malloc(sizeof(pid_t) * max_processes);
+    if (userPool == NULL) {
+      perror("malloc");
+      exit(1);
+    }
+    for (i = 0; i < max_processes; i++) {
+      resetChannel(&transport, i);
+      userPool[i] = forkUserProc(transportMode, i, &config, workloadSpec, workload.readPercent, 0, batch, true);
+    }
+  }
 
   MemoryRequest request;
 
@@ -273,131 +637,266 @@ int main(int argc, char const* argv[]) {
       break;
     }
 
-    // Print frame table if specified time has elapsed
-    if (time_between_nano(*sclock, previousPCBPrint) >= 500000000) {
-      printFrameTable(frameTable, sclock);
-      previousPCBPrint.seconds = sclock->seconds;
-      previousPCBPrint.nanoseconds = sclock->nanoseconds;
-    }
-
-    // Check if the queue is not empty
-    if (!queueIsEmpty(queue)) {
-      for (i = 0; i < 18; i++) {
-        if (blockedTimes[i].seconds == -1) break;
-
-        // Check if process has waited long enough in the queue
-        int timeBetween = time_between_nano(*sclock, blockedTimes[i]);
-        if (timeBetween >= 14000000) {
-          int pid = popQueue(queue);
-          popBlockedTimes(blockedTimes);
-
-          request.msg_type = pid;
-
-          // Send message to process
-          if (msgsnd(msgqid, &request, sizeof(request) - sizeof(long), 0) == -1) {
-            perror("msgsnd");
-            exit(1);
-          }
+    // Fire every event that is due at the current time
+    Event event;
+    while (peekEvent(&events, &event) && event.time <= clock_to_nano(*sclock)) {
+      popEvent(&events, &event);
+      switch (event.type) {
+      case EVENT_FAULT_DONE:
+        // The page is in memory now, so let the blocked process continue, unless it
+        // was swapped out meanwhile
+        if (processSuspended(event.slot)) {
+          parkReply(event.slot);
+        } else {
+          sendResponse(&transport, &faultReplies[event.slot], event.slot);
+        }
+        statsFaultDone(stats, event.slot, sclock);
+        blocked_children--;
+        break;
+      case EVENT_LAUNCH:
+        launchDue = true;
+        break;
+      case EVENT_PRINT:
+        if (parallelWorkers > 1) {
+          parallelLogFrameTable(sclock);
+        } else {
+          logFrameTable(frameTable, sclock);
+        }
+        scheduleEvent(&events, event.time + 500000000, EVENT_PRINT, -1, -1);
+        break;
+      case EVENT_WRITEBACK_DONE:
+        finishWriteBack(frameTable);
+        break;
+      case EVENT_LOAD_CHECK: {
+        int target;
+        int percent;
+        LoadDecision decision = checkLoad(frameTable, &target, &percent);
+        if (decision == LOAD_SUSPEND) {
+          // The process's dirty pages go out in one write as it is swapped out
+          int freed;
+          int dirtyPages = suspendProcess(frameTable, pageTables, target, &freed);
+          if (dirtyPages > 0) writeBackNow(event.time, dirtyPages);
+          statsSuspend(stats, target, true);
+          logEvent(LOG_SUSPEND, sclock, processPid(target), percent, freed);
+        } else if (decision == LOAD_RESUME) {
+          if (resumeProcess(target)) sendResponse(&transport, &faultReplies[target], target);
+          statsSuspend(stats, target, false);
+          logEvent(LOG_RESUME, sclock, processPid(target), percent, 0);
         }
+        scheduleEvent(&events, clock_to_nano(*sclock) + LOAD_CHECK_NANOS, EVENT_LOAD_CHECK, -1, -1);
+        break;
+      }
       }
     }
 
-    // Receive message from the message queue
-    if (msgrcv(msgqid, &request, sizeof(MemoryRequest) - sizeof(long), 1, IPC_NOWAIT) == -1) {
-      if (errno != ENOMSG) { // Ignore ENOMSG errors
-        perror("msgrcv failed");
-        exit(1);
+    // Free the slots of processes that terminated as soon as SIGCHLD says so
+    running_children -= reapChildren();
+
+    // Receive message from the message queue or rings
+    int slot;
+    bool received = false;
+    bool canLaunch = running_children < max_processes && created_children < total_processes &&
+      !loadControlHoldsLaunches();
+    if (parallelWorkers > 1) {
+      // The workers have already served the requests; block the processes that faulted
+      FaultNotice* notices;
+      int count = takeFaultNotices(&notices);
+      for (i = 0; i < count; i++) {
+        faultReplies[notices[i].slot] = notices[i].reply;
+        scheduleEvent(&events, clock_to_nano(*sclock) + DISK_READ_NANOS, EVENT_FAULT_DONE, notices[i].reply.pid, notices[i].slot);
+        blocked_children++;
+      }
+      if (count == 0) {
+        waitForWorkersOrEvent(&events, running_children, blocked_children, launchDue, canLaunch);
       }
+    } else if (takeResumedRequest(&request, &slot)) {
+      received = true;
     } else {
-      request.msg_type = request.pid;
-      assignProcess(pcb, request.pid);
-      printf("Process %d requesting %s of address %d at time %u:%u\n", request.pid, request.isRead ? "read" : "write", request.address, sclock->seconds, sclock->nanoseconds);
-
-      int frameNumber = getFrameFromAddr(request.address, pageTables, findProcessIndex(pcb, request.pid));
-      if (frameNumber == -1) {
-        printf("Address %d is not in a frame, pagefault\n", request.address);
-
-        pushToQueue(queue, request.pid);
-        pushToBlockedTimes(blockedTimes, sclock->seconds, sclock->nanoseconds);
-
-        replacePage(frameTable, request.address, pageTables, findProcessIndex(pcb, request.pid));
-      } else {
-        printf("Address %d in frame %d ", request.address, frameNumber);
-
-        increment_clock(sclock, 100);
-
-        if (request.isRead) {
-          printf("Giving data to Process %d at time %u:%u\n", request.pid, sclock->seconds, sclock->nanoseconds);
-
-          // Send message to process
-          if (msgsnd(msgqid, &request, sizeof(request) - sizeof(long), 0) == -1) {
-            perror("msgsnd");
-            exit(1);
+      // Processes whose request or reply load control is holding won't send anything
+      received = receiveRequest(&transport, &request, &slot);
+      if (!received) {
+        received = waitForEvent(&request, &slot, &events, running_children, blocked_children + parkedProcesses(),
+          launchDue, canLaunch);
+      }
+      if (received && slot == -1) slot = findProcessSlot(request.pid);
+      // A pooled process's simulated process terminated; the pooled process waits for
+      // the next one
+      if (received && request.status == REQUEST_EXIT) {
+        endProcess(request.pid);
+        running_children--;
+        received = false;
+      }
+      // A swapped-out process's request waits until it is resumed
+      if (received && processSuspended(slot)) {
+        parkRequest(slot, &request);
+        received = false;
+      }
+    }
+    if (received) {
+
+      // Serve the references in order until one of them faults
+      request.status = REQUEST_DONE;
+      for (request.completed = 0; request.completed < request.count && request.status == REQUEST_DONE;
+        request.completed++) {
+        uint64_t address = request.addresses[request.completed];
+        bool isRead = (request.reads >> request.completed) & 1;
+        logEvent(LOG_REQUEST, sclock, request.pid, isRead, address);
+
+        writeTraceRecord(&traceWriter, TRACE_ACCESS, clock_to_nano(*sclock), request.pid, slot, address, isRead);
+
+        AccessResult result = accessPage(frameTable, pageTables, slot, address, isRead);
+        int frameNumber = result.frame;
+        statsAccess(stats, slot, isRead, &result, sclock);
+        if (loadControlEnabled()) loadControlAccess(slot, result.fault);
+        if (result.fault) {
+          if (result.copied) {
+            logEvent(LOG_COPY, sclock, address, frameNumber, request.pid);
+          } else {
+            logEvent(LOG_FAULT, sclock, address, 0, 0);
           }
-        } else {
-          printf("writing data to frame at time %u:%u\n", sclock->seconds, sclock->nanoseconds);
 
-          frameTable->frames[frameNumber].dirty_bit = 1;
-          printf("Dirty bit of frame %d set, adding additional time to the clock\n", frameNumber);
+          // A page in the compressed pool is decompressed instead of read from disk.
+          // Taking it out first leaves room in the pool for the page it displaced. A
+          // copy of a shared page comes from the frame it was shared in.
+          long long pageNumber = address >> pageTables->pageShift;
+          bool poolDirty = false;
+          bool fromPool = !result.copied && zswapEnabled() && zswapLoad(slot, pageNumber, &poolDirty);
+          if (fromPool) {
+            if (poolDirty) setFrameBit(frameTable->dirty, frameNumber);
+            logEvent(LOG_ZSWAP_LOAD, sclock, address, frameNumber, 0);
+          }
+          int dirtyPages = zswapEvicted(&result);
+
+          // Pages read ahead come in with the faulting one, in the same I/O
+          PrefetchResult prefetch = { 0, 0, 0, 0, 0 };
+          if (prefetchEnabled() && !fromPool && !result.copied) {
+            prefetch = prefetchAfterFault(frameTable, pageTables, slot, pageNumber, frameNumber);
+            statsPrefetch(stats, prefetch.pages, 0, prefetch.wasted);
+            if (prefetch.pages > 0) logEvent(LOG_PREFETCH, sclock, address, prefetch.pages, prefetch.evictions);
+          }
 
-          if (msgsnd(msgqid, &request, sizeof(request) - sizeof(long), 0) == -1) {
-            perror("msgsnd");
-            exit(1);
+          // Block the process until the pages have been read in, after the pages they
+          // displaced have been written out if any were dirty
+          unsigned long long readAt = clock_to_nano(*sclock);
+          dirtyPages += prefetch.diskWrites;
+          if (dirtyPages > 0) readAt = writeBackNow(readAt, dirtyPages);
+          unsigned long long readNanos = result.copied ? PAGE_COPY_NANOS : fromPool ? ZSWAP_LOAD_NANOS :
+            DISK_READ_NANOS + (unsigned long long)prefetch.pages * DISK_CLUSTER_PAGE_NANOS;
+          scheduleEvent(&events, readAt + readNanos, EVENT_FAULT_DONE, request.pid, slot);
+          if (zswapEnabled()) statsZswap(stats, &zswapCounts, zswapUsedBytes());
+          blocked_children++;
+          request.status = REQUEST_FAULTED;
+
+          // Free frames ahead of the next faults if this one ran the pool low
+          runPageOut(frameTable, pageTables, &events, sclock, stats);
+        } else {
+          // Translating through the TLB is cheaper than walking the page table
+          increment_clock(sclock, result.tlbHit ? TLB_HIT_NANOS : PAGE_WALK_NANOS);
+          if (prefetchEnabled() && prefetchUsed(frameNumber)) statsPrefetch(stats, 0, 1, 0);
+
+          if (isRead) {
+            logEvent(LOG_HIT_READ, sclock, address, frameNumber, request.pid);
+          } else {
+            logEvent(LOG_HIT_WRITE, sclock, address, frameNumber, 0);
           }
         }
       }
-    }
 
-    increment_clock(sclock, 5000);
-    unsigned int elapsedNano = time_between_nano(*sclock, previousLaunchTime);
-
-    if (elapsedNano >= randGap) {
-      // Check if there is room to create a new process
-      if (running_children < max_processes && created_children < total_processes) {
-        previousLaunchTime.seconds = sclock->seconds;
-        previousLaunchTime.nanoseconds = sclock->nanoseconds;
+      // The reply carries no references back
+      request.count = 0;
+      if (request.status == REQUEST_FAULTED) {
+        faultReplies[slot] = request;
+      } else {
+        // Send message to process
+        sendResponse(&transport, &request, slot);
+      }
+    }
 
-        // Fork a new process.
-        pid_t pid = fork();
+    if (parallelWorkers > 1) {
+      // Time moves on by what the workers spent serving requests
+      increment_clock(sclock, takeWorkerNanos());
+      publishClock(sclock);
+    } else {
+      increment_clock(sclock, 5000);
+    }
 
-        // If fork failed.
-        if (pid < 0) {
+    // Check if there is room to create a new process, and load control isn't holding
+    // launches back
+    if (launchDue && canLaunch) {
+      // Pick the process slot up front so the child knows which channel to use
+      int slot = freeProcessSlot();
+
+      // Every process's references follow from the run seed and its launch order
+      uint64_t seed = workloadSeed(runSeed, created_children);
+
+      pid_t pid;
+      if (pooled) {
+        // Hand the process to the slot's pooled user process, which is waiting for it;
+        // its pid is just a label
+        pid = created_children + 1;
+        MemoryRequest start;
+        start.pid = pid;
+        start.count = 1;
+        start.completed = 0;
+        start.status = REQUEST_START;
+        start.reads = 0;
+        start.addresses[0] = seed;
+        sendResponse(&transport, &start, slot);
+      } else if (transportMode == TRANSPORT_THREAD) {
+        // Run the user process as a thread inside oss; its pid is just a label
+        resetChannel(&transport, slot);
+        pid = created_children + 1;
+        if (!startUserThread(&transport, slot, pid, &config, &workload, seed, batch)) {
           printf("Fork failed!\n");
           exit(1);
-        }// If this is the child process.
-        else if (pid == 0) {
-          // Set the process group ID of the child process to that of the parent
-          setpgid(0, getppid());
-          printf("Process %d launched at %u:%u\n", created_children, sclock->seconds, sclock->nanoseconds);
-
-          // Execute the user process
-          execl("./user_proc", "./user_proc", NULL);
-          exit(1);
-        }
-        // If this is the parent process.
-        else {
-          created_children++;
-          running_children++;
-          randGap = (rand() % (500000000 - 1000000 + 1)) + 1000000;
-          previousLaunchTime.nanoseconds = sclock->nanoseconds;
-          previousLaunchTime.seconds = sclock->seconds;
         }
       } else {
-        // Check if any child processes have finished
-        int status;
-        pid_t pid = waitpid(-1, &status, WNOHANG);
-        if (pid > 0) {
-          printFrameTable(frameTable, sclock);
-          removeProcessPages(frameTable, pageTables, findProcessIndex(pcb, pid));
-          clearProcess(pcb, pid);
-          printf("Process %d terminated\n", pid);
-          running_children--;
-        }
+        // Fork a new process.
+        resetChannel(&transport, slot);
+        pid = forkUserProc(transportMode, slot, &config, workloadSpec, workload.readPercent, seed, batch, false);
       }
+
+      assignProcess(slot, pid);
+      statsLaunch(stats, slot, pid);
+      if (loadControlEnabled()) loadControlLaunch(slot);
+      logEvent(LOG_LAUNCH, sclock, created_children, 0, 0);
+      created_children++;
+      running_children++;
+      launchDue = false;
+      randGap = (rand() % (500000000 - 1000000 + 1)) + 1000000;
+      scheduleEvent(&events, clock_to_nano(*sclock) + randGap, EVENT_LAUNCH, -1, -1);
+    }
+  }
+
+  // Stop the pool and wait for its processes to exit
+  if (pooled) {
+    MemoryRequest stop;
+    stop.pid = 0;
+    stop.count = 0;
+    stop.completed = 0;
+    stop.status = REQUEST_STOP;
+    stop.reads = 0;
+    for (i = 0; i < max_processes; i++) {
+      sendResponse(&transport, &stop, i);
+    }
+    for (i = 0; i < max_processes; i++) {
+      waitpid(userPool[i], NULL, 0);
     }
+    free(userPool);
+    userPool = NULL;
   }
 
   // Clear allocated resources
+  if (parallelWorkers > 1) stopWorkers();
+  freeEventQueue(&events);
+  freeUserThreads();
+  freeTlb();
+  freePageOut();
+  freePrefetch();
+  freeZswap();
+  freeLoadControl();
+  free(faultReplies);
+  freeProcessTable();
   clearEverything();
   return 0;
 }
@@ -0,0 +1,43 @@
+/**
+ * @file osslog.c
+ * @date 2026-10-17
+ *
+ * Decodes a binary log written by "oss -l" back into oss's text output.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "log.h"
+
+int main(int argc, char const* argv[]) {
+  if (argc != 2) {
+    printf("Usage: %s logfile\n", argv[0]);
+    exit(1);
+  }
+
+  FILE* file = fopen(argv[1], "rb");
+  if (file == NULL) {
+    perror("fopen");
+    exit(1);
+  }
+
+  LogHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != LOG_MAGIC ||
+    header.version != LOG_VERSION || header.recordSize != LOG_RECORD_SIZE) {
+    fprintf(stderr, "%s is not a version %d oss log\n", argv[1], LOG_VERSION);
+    exit(1);
+  }
+
+  LogRecord records[4096];
+  size_t count;
+  while ((count = fread(records, sizeof(LogRecord), 4096, file)) > 0) {
+    size_t i;
+    for (i = 0; i < count; i++) {
+      formatLogRecord(stdout, &records[i]);
+    }
+  }
+
+  fclose(file);
+  return 0;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file ossstat.c
+ * @date 2026-10-17
+ *
+ * Live monitor for a running oss. Attaches to the shared statistics segment and prints
+ * vmstat-style rates every interval without disturbing the simulation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+// Print command-line usage
+void printUsage(const char* program) {
+  printf("Usage: %s [-h] [-i seconds] [-n count] [-s]\n", program);
+  printf("  -i  seconds between reports (default 1)\n");
+  printf("  -n  number of reports before exiting (default: until oss exits)\n");
+  printf("  -s  also print the counters of every process slot\n");
+}
+
+double wallSeconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Take a consistent-enough copy of the counters
+void snapshot(const StatsBlock* stats, StatsBlock* copy) {
+  memcpy(copy, stats, statsBlockSize(stats->slotCount));
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+// Fault service time, in milliseconds, below which the given fraction of faults finished
+double latencyPercentile(const uint64_t* counts, uint64_t total, double fraction) {
+  if (total == 0) return 0.0;
+
+  uint64_t target = (uint64_t)(total * fraction);
+  uint64_t seen = 0;
+  int i;
+  for (i = 0; i < STATS_LATENCY_BUCKETS; i++) {
+    seen += counts[i];
+    if (seen > target) return (1ULL << (i + 1)) / 1e6;
+  }
+  return (1ULL << STATS_LATENCY_BUCKETS) / 1e6;
+}
+
+void printHeader() {
+  printf("%10s %4s %4s %4s %9s %9s %9s %6s %6s %9s %9s %9s %9s %9s %9s %6s %8s %8s %8s\n", "sim time", "run", "blk", "out",
+    "acc/s", "rd/s", "wr/s", "hit%", "tlb%", "flt/s", "cow/s", "evict/s", "dirty/s", "pgout/s", "rahead/s", "zhit%", "avg ms",
+    "p50 ms", "p99 ms");
+}
+
+void printSlots(const StatsBlock* stats) {
+  printf("  %4s %8s %10s %10s %10s %10s %10s %10s %12s\n", "slot", "pid", "accesses", "hits", "tlb hits", "faults",
+    "evictions", "dirty", "blocked ms");
+  unsigned int i;
+  for (i = 0; i < stats->slotCount; i++) {
+    const SlotStats* slot = &stats->slots[i];
+    if (slot->pid == 0) continue;
+    printf("  %4u %8lld %10llu %10llu %10llu %10llu %10llu %10llu %12.1f\n", i, (long long)slot->pid,
+      (unsigned long long)slot->accesses, (unsigned long long)slot->hits, (unsigned long long)slot->tlbHits,
+      (unsigned long long)slot->faults,
+      (unsigned long long)slot->evictions, (unsigned long long)slot->dirtyEvictions, slot->blockedNanos / 1e6);
+  }
+}
+
+int main(int argc, char const* argv[]) {
+  double interval = 1.0;
+  long reports = -1;
+  bool showSlots = false;
+
+  int opt;
+  while ((opt = getopt(argc, (char* const*)argv, "hi:n:s")) != -1) {
+    switch (opt) {
+    case 'i':
+      interval = atof(optarg);
+      break;
+    case 'n':
+      reports = atol(optarg);
+      break;
+    case 's':
+      showSlots = true;
+      break;
+    case 'h':
+      printUsage(argv[0]);
+      exit(0);
+    default:
+      printUsage(argv[0]);
+      exit(1);
+    }
+  }
+  if (interval <= 0) interval = 1.0;
+
+  // Wait for oss to create the block, then attach just the header until it has said
+  // how many slots there are
+  StatsBlock* stats;
+  while ((stats = findStats(0)) == NULL) {
+    usleep(100000);
+  }
+  while (__atomic_load_n(&stats->magic, __ATOMIC_ACQUIRE) != STATS_MAGIC || !statsRead(&stats->running)) {
+    usleep(100000);
+  }
+  if (stats->version != STATS_VERSION) {
+    fprintf(stderr, "oss statistics are version %u, expected %d\n", stats->version, STATS_VERSION);
+    exit(1);
+  }
+
+  int slotCount = stats->slotCount;
+  detachStats(stats, false);
+  stats = findStats(slotCount);
+  if (stats == NULL) {
+    perror("find_memory_block");
+    exit(1);
+  }
+
+  StatsBlock* previous = malloc(statsBlockSize(slotCount));
+  StatsBlock* current = malloc(statsBlockSize(slotCount));
+  if (previous == NULL || current == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  snapshot(stats, previous);
+  double previousTime = wallSeconds();
+  long printed = 0;
+
+  while (reports < 0 || printed < reports) {
+    usleep((useconds_t)(interval * 1000000));
+    snapshot(stats, current);
+    double now = wallSeconds();
+    double elapsed = now - previousTime;
+
+    if (printed % 20 == 0 || showSlots) printHeader();
+
+    const SlotStats* a = &previous->total;
+    const SlotStats* b = &current->total;
+    uint64_t accesses = b->accesses - a->accesses;
+    uint64_t hits = b->hits - a->hits;
+    uint64_t faults = b->faults - a->faults;
+
+    uint64_t latencies[STATS_LATENCY_BUCKETS];
+    uint64_t served = 0;
+    int i;
+    for (i = 0; i < STATS_LATENCY_BUCKETS; i++) {
+      latencies[i] = current->faultLatency[i] - previous->faultLatency[i];
+      served += latencies[i];
+    }
+
+    int blocked = 0;
+    int suspended = 0;
+    for (i = 0; i < (int)current->slotCount; i++) {
+      if (current->slots[i].pid == 0) continue;
+      if (current->slots[i].blockedSince != 0) blocked++;
+      if (current->slots[i].suspended) suspended++;
+    }
+
+    printf("%10.3f %4llu %4d %4d %9.0f %9.0f %9.0f %6.1f %6.1f %9.0f %9.0f %9.0f %9.0f %9.0f %9.0f %6.1f %8.2f %8.2f %8.2f\n",
+      current->simTime / 1e9, (unsigned long long)(current->launches - current->terminations), blocked, suspended,
+      accesses / elapsed, (b->reads - a->reads) / elapsed, (b->writes - a->writes) / elapsed,
+      accesses ? 100.0 * hits / accesses : 0.0, accesses ? 100.0 * (b->tlbHits - a->tlbHits) / accesses : 0.0,
+      faults / elapsed, (b->copies - a->copies) / elapsed, (b->evictions - a->evictions) / elapsed,
+      (b->dirtyEvictions - a->dirtyEvictions) / elapsed,
+      (current->pageOutFreed + current->writeBackPages - previous->pageOutFreed - previous->writeBackPages) / elapsed,
+      (current->prefetched - previous->prefetched) / elapsed,
+      faults ? 100.0 * (current->zswapLoads - previous->zswapLoads) / faults : 0.0,
+      served ? (b->blockedNanos - a->blockedNanos) / 1e6 / served : 0.0,
+      latencyPercentile(latencies, served, 0.5), latencyPercentile(latencies, served, 0.99));
+    if (showSlots) printSlots(current);
+    fflush(stdout);
+
+    StatsBlock* swap = previous;
+    previous = current;
+    current = swap;
+    previousTime = now;
+    printed++;
+
+    if (!statsRead(&stats->running)) {
+      printf("oss exited\n");
+      break;
+    }
+  }
+
+  free(previous);
+  free(current);
+  detachStats(stats, false);
+  return 0;
+}
@@ -0,0 +1,544 @@
+/**
+ * @file osssweep.c
+ * @date 2026-10-17
+ *
+ * Parameter sweep runner. Runs the paging engine in-process for every point of a grid of
+ * policies, frame counts, workloads, process counts, page counts and TLB sizes, with the
+ * points spread over forked workers, and writes one row per point as CSV or JSON. With
+ * -M it instead computes the LRU miss ratio curve of each workload in a single pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "structs.h"
+#include "policy.h"
+#include "tlb.h"
+#include "trace.h"
+#include "workload.h"
+#include "prefetch.h"
+#include "zswap.h"
+#include "replay.h"
+#include "mrc.h"
+
+#define DEFAULT_SWEEP_REFERENCES 1000000
+
+// Most rows a miss ratio curve is written as when no frame counts are given
+#define CURVE_ROWS 1000
+
+// A comma-separated list from the command line
+typedef struct {
+  char** items;
+  int count;
+} List;
+
+// One point of the grid
+typedef struct {
+  const char* policy;
+  const char* workload;
+  int frames;
+  int processes;
+  int pages;
+  int tlbEntries;
+  const char* pool;  // compressed pool, as for oss -Z
+} Point;
+
+// What a worker sends back for its point
+typedef struct {
+  bool ok;
+  ReplayCounts counts;
+} PointResult;
+
+// A worker running a point
+typedef struct {
+  pid_t pid;
+  int point;
+  int fd;
+} Job;
+
+// Print command-line usage
+void printUsage(const char* program) {
+  printf("Usage: %s [-h] [-p policies] [-f frames] [-W workloads] [-c processes] [-g pages]\n", program);
+  printf("          [-b tlb entries] [-Z pools] [-z page size] [-x address bits] [-H] [-A window]\n");
+  printf("          [-s shared pages] [-R read percent]\n");
+  printf("          [-n references] [-S seed] [-r trace] [-j jobs] [-o output] [-M rate]\n");
+  printf("Every option taking a plural is a comma-separated list; every combination is run.\n");
+  printf("  -p  replacement policies: %s (default clock)\n", replacementPolicyNames());
+  printf("  -f  frames of physical memory (default %d)\n", DEFAULT_FRAME_COUNT);
+  printf("  -W  workloads, as for oss -W (default uniform)\n");
+  printf("  -c  process slots (default %d)\n", DEFAULT_PROCESS_COUNT);
+  printf("  -g  pages in each process's address space (default %d)\n", DEFAULT_PAGES_PER_PROCESS);
+  printf("  -b  TLB entries per process, 0 for no TLB (default %d)\n", DEFAULT_TLB_ENTRIES);
+  printf("  -Z  compressed pools, each frames[:ratio[:spread]] as for oss -Z (default 0, none)\n");
+  printf("  -z  page size in bytes (default %d)\n", DEFAULT_PAGE_SIZE);
+  printf("  -x  bits of each process's virtual address space (default: just enough)\n");
+  printf("  -H  fault in huge pages\n");
+  printf("  -s  pages each process shares with the others, as for oss -s (default 0)\n");
+  printf("  -A  read-ahead window in pages at every point, as for oss -A (default 0, off)\n");
+  printf("  -R  percentage of references that are reads (default %d)\n", DEFAULT_READ_PERCENT);
+  printf("  -n  references simulated at each point (default %d)\n", DEFAULT_SWEEP_REFERENCES);
+  printf("  -S  seed every point's processes derive their seeds from (default 1)\n");
+  printf("  -r  replay a trace at every point instead; -W, -c, -g, -z and -x come from it\n");
+  printf("  -j  points run at once (default: one per CPU)\n");
+  printf("  -o  write the table to a file, as JSON if its name ends in .json (default: CSV on stdout)\n");
+  printf("  -M  write the LRU miss ratio curve of each workload instead, from one pass that\n");
+  printf("      samples this fraction of pages (1 is exact); -p, -b, -Z and -A are ignored and -f, if\n");
+  printf("      given, picks the frame counts to report\n");
+}
+
+// Split a comma-separated list. The list keeps a copy of the text.
+List parseList(const char* text) {
+  List list;
+  list.count = 0;
+  list.items = malloc(sizeof(char*) * (strlen(text) / 2 + 1));
+  char* copy = strdup(text);
+  if (list.items == NULL || copy == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  char* item;
+  for (item = strtok(copy, ","); item != NULL; item = strtok(NULL, ",")) {
+    list.items[list.count++] = item;
+  }
+  if (list.count == 0) {
+    fprintf(stderr, "Empty list\n");
+    exit(1);
+  }
+  return list;
+}
+
+int listInt(const List* list, int index) {
+  return atoi(list->items[index]);
+}
+
+// Shape of the system at a point
+PagingConfig pointConfig(const Point* point, const PagingConfig* base) {
+  PagingConfig config = *base;
+  config.frameCount = point->frames;
+  config.processCount = point->processes;
+  config.pagesPerProcess = point->pages;
+  if (config.addressBits == 0) config.addressBits = denseAddressBits(&config);
+  return config;
+}
+
+// Run one point in a worker and write its result to fd
+void runPoint(const Point* point, const PagingConfig* base, const WorkloadConfig* workloadBase,
+  const TraceReader* reader, uint64_t seed, unsigned long long references, int fd) {
+  PointResult result;
+  memset(&result, 0, sizeof(result));
+
+  selectReplacementPolicy(point->policy);
+  tlbConfig.entries = point->tlbEntries;
+  if (tlbConfig.ways > tlbConfig.entries && tlbConfig.entries > 0) tlbConfig.ways = tlbConfig.entries;
+  parseZswapConfig(point->pool, &zswapConfig);
+
+  PagingConfig config = pointConfig(point, base);
+  if (reader != NULL) {
+    result.ok = runTrace(reader, &config, &result.counts);
+  } else {
+    WorkloadConfig workload = *workloadBase;
+    parseWorkload(point->workload, &workload);
+    result.ok = runWorkload(&config, &workload, seed, references, &result.counts);
+  }
+
+  if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+    perror("write");
+    _exit(1);
+  }
+  _exit(0);
+}
+
+// Open the file the table goes to, stdout if there is none. It is JSON if its name ends
+// in .json.
+FILE* openOutput(const char* path, bool* json) {
+  *json = false;
+  if (path == NULL) return stdout;
+  FILE* out = fopen(path, "w");
+  if (out == NULL) {
+    perror("fopen");
+    exit(1);
+  }
+  size_t length = strlen(path);
+  *json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+  return out;
+}
+
+// Compute the miss ratio curve of each workload, process count and page count with one
+// pass over its references, and write its fault rate at the requested frame counts (or
+// across the whole curve). Returns false if a pass failed.
+bool writeCurves(FILE* out, bool json, const List* workloads, const List* processes, const List* pages,
+  const List* frames, bool framesGiven, const PagingConfig* base, const WorkloadConfig* workloadBase,
+  const TraceReader* reader, const char* tracePath, uint64_t seed, unsigned long long references, double rate) {
+  if (json) {
+    fprintf(out, "[\n");
+  } else {
+    fprintf(out, "workload,processes,pages,frames,fault_rate,references,sampled,seconds\n");
+  }
+
+  bool first = true;
+  int a, b, c, i;
+  for (a = 0; a < workloads->count; a++) {
+    for (b = 0; b < processes->count; b++) {
+      for (c = 0; c < pages->count; c++) {
+        Point point;
+        memset(&point, 0, sizeof(point));
+        point.workload = reader != NULL ? tracePath : workloads->items[a];
+        point.processes = listInt(processes, b);
+        point.pages = listInt(pages, c);
+        point.frames = base->frameCount;
+        PagingConfig config = pointConfig(&point, base);
+
+        // Every page resident at once can only miss on first references
+        int maxFrames = config.processCount * config.pagesPerProcess;
+        MissRatioCurve curve;
+        if (!initMissRatioCurve(&curve, config.processCount, config.pageSize, maxFrames, rate)) return false;
+        ReferenceSink sink = { mrcAccess, mrcExit, &curve };
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        bool ok;
+        if (reader != NULL) {
+          ok = feedTrace(reader, &config, &sink);
+        } else {
+          WorkloadConfig workload = *workloadBase;
+          parseWorkload(point.workload, &workload);
+          ok = feedWorkload(&config, &workload, seed, references, &sink);
+        }
+        if (!ok) return false;
+        finishMissRatioCurve(&curve);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        int rows = framesGiven ? frames->count : (maxFrames < CURVE_ROWS ? maxFrames : CURVE_ROWS);
+        for (i = 0; i < rows; i++) {
+          int frameCount = framesGiven ? listInt(frames, i) : (int)((long long)maxFrames * (i + 1) / rows);
+          double faultRate = missRatio(&curve, frameCount);
+          if (json) {
+            fprintf(out, "%s  {\"workload\": \"%s\", \"processes\": %d, \"pages\": %d, \"frames\": %d, "
+              "\"fault_rate\": %.6f, \"references\": %llu, \"sampled\": %llu, \"seconds\": %.3f}",
+              first ? "" : ",\n", point.workload, point.processes, point.pages, frameCount, faultRate,
+              curve.references, curve.sampled, seconds);
+          } else {
+            fprintf(out, "%s,%d,%d,%d,%.6f,%llu,%llu,%.3f\n", point.workload, point.processes, point.pages,
+              frameCount, faultRate, curve.references, curve.sampled, seconds);
+          }
+          first = false;
+        }
+        freeMissRatioCurve(&curve);
+      }
+    }
+  }
+
+  if (json) fprintf(out, "\n]\n");
+  return true;
+}
+
+// Write the results, one row per point
+void writeTable(FILE* out, bool json, const Point* points, const PointResult* results, int count) {
+  if (json) {
+    fprintf(out, "[\n");
+  } else {
+    fprintf(out, "policy,frames,workload,processes,pages,tlb_entries,pool,accesses,writes,faults,fault_rate,"
+      "pool_loads,disk_writes,copies,evictions,dirty_evictions,prefetched,prefetch_hits,tlb_hits,tlb_hit_rate,exits,"
+      "translation_ms,seconds\n");
+  }
+
+  int i;
+  for (i = 0; i < count; i++) {
+    const Point* point = &points[i];
+    const ReplayCounts* counts = &results[i].counts;
+    double faultRate = counts->accesses ? (double)counts->faults / counts->accesses : 0.0;
+    double tlbHitRate = counts->accesses ? (double)counts->tlbHits / counts->accesses : 0.0;
+    if (json) {
+      fprintf(out, "  {\"policy\": \"%s\", \"frames\": %d, \"workload\": \"%s\", \"processes\": %d, \"pages\": %d, "
+        "\"tlb_entries\": %d, \"pool\": \"%s\", \"accesses\": %llu, \"writes\": %llu, \"faults\": %llu, "
+        "\"fault_rate\": %.6f, \"pool_loads\": %llu, \"disk_writes\": %llu, \"copies\": %llu, "
+        "\"evictions\": %llu, \"dirty_evictions\": %llu, \"prefetched\": %llu, \"prefetch_hits\": %llu, "
+        "\"tlb_hits\": %llu, \"tlb_hit_rate\": %.6f, \"exits\": %llu, \"translation_ms\": %.3f, \"seconds\": %.3f}%s\n",
+        point->policy, point->frames, point->workload, point->processes, point->pages, point->tlbEntries,
+        point->pool, counts->accesses, counts->writes, counts->faults, faultRate, counts->zswapLoads,
+        counts->diskWrites, counts->copies, counts->evictions, counts->dirtyEvictions, counts->prefetched,
+        counts->prefetchHits, counts->tlbHits, tlbHitRate, counts->exits, translationNanos(counts) / 1e6, counts->seconds,
+        i + 1 < count ? "," : "");
+    } else {
+      fprintf(out, "%s,%d,%s,%d,%d,%d,%s,%llu,%llu,%llu,%.6f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.6f,%llu,%.3f,%.3f\n",
+        point->policy, point->frames, point->workload, point->processes, point->pages, point->tlbEntries,
+        point->pool, counts->accesses, counts->writes, counts->faults, faultRate, counts->zswapLoads,
+        counts->diskWrites, counts->copies, counts->evictions, counts->dirtyEvictions, counts->prefetched,
+        counts->prefetchHits, counts->tlbHits, tlbHitRate, counts->exits, translationNanos(counts) / 1e6, counts->seconds);
+    }
+  }
+
+  if (json) fprintf(out, "]\n");
+}
+
+int main(int argc, char const* argv[]) {
+  char defaultFrames[16], defaultProcesses[16], defaultPages[16], defaultTlb[16];
+  snprintf(defaultFrames, sizeof(defaultFrames), "%d", DEFAULT_FRAME_COUNT);
+  snprintf(defaultProcesses, sizeof(defaultProcesses), "%d", DEFAULT_PROCESS_COUNT);
+  snprintf(defaultPages, sizeof(defaultPages), "%d", DEFAULT_PAGES_PER_PROCESS);
+  snprintf(defaultTlb, sizeof(defaultTlb), "%d", DEFAULT_TLB_ENTRIES);
+  const char* policyText = "clock";
+  const char* frameText = defaultFrames;
+  const char* workloadText = "uniform";
+  const char* processText = defaultProcesses;
+  const char* pageText = defaultPages;
+  const char* tlbText = defaultTlb;
+  const char* poolText = "0";
+  const char* tracePath = NULL;
+  const char* outputPath = NULL;
+  PagingConfig base;
+  defaultPagingConfig(&base);
+  WorkloadConfig workloadBase;
+  defaultWorkloadConfig(&workloadBase);
+  unsigned long long references = DEFAULT_SWEEP_REFERENCES;
+  uint64_t seed = 1;
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  bool framesGiven = false;
+  double curveRate = 0;
+
+  int opt;
+  while ((opt = getopt(argc, (char* const*)argv, "hp:f:W:c:g:b:Z:z:x:Hs:A:R:n:S:r:j:o:M:")) != -1) {
+    switch (opt) {
+    case 'p':
+      policyText = optarg;
+      break;
+    case 'f':
+      frameText = optarg;
+      framesGiven = true;
+      break;
+    case 'W':
+      workloadText = optarg;
+      break;
+    case 'c':
+      processText = optarg;
+      break;
+    case 'g':
+      pageText = optarg;
+      break;
+    case 'b':
+      tlbText = optarg;
+      break;
+    case 'z':
+      base.pageSize = atoi(optarg);
+      break;
+    case 'x':
+      base.addressBits = atoi(optarg);
+      break;
+    case 'H':
+      base.hugePages = true;
+      break;
+    case 's':
+      base.sharedPages = atoi(optarg);
+      break;
+    case 'Z':
+      poolText = optarg;
+      break;
+    case 'A':
+      prefetchConfig.window = atoi(optarg);
+      break;
+    case 'R':
+      workloadBase.readPercent = atoi(optarg);
+      break;
+    case 'n':
+      references = strtoull(optarg, NULL, 10);
+      break;
+    case 'S':
+      seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'r':
+      tracePath = optarg;
+      break;
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 'o':
+      outputPath = optarg;
+      break;
+    case 'M':
+      curveRate = atof(optarg);
+      if (curveRate <= 0 || curveRate > 1) {
+        fprintf(stderr, "The sampling rate must be above 0 and at most 1\n");
+        exit(1);
+      }
+      break;
+    case 'h':
+      printUsage(argv[0]);
+      exit(0);
+    default:
+      printUsage(argv[0]);
+      exit(1);
+    }
+  }
+  if (jobs < 1) jobs = 1;
+
+  // A trace fixes the processes and their references; every point replays all of it
+  TraceReader reader;
+  if (tracePath != NULL) {
+    if (!openTraceReader(&reader, tracePath)) exit(1);
+    bool hugePages = base.hugePages;
+    base = reader.config;
+    base.hugePages = hugePages;
+    snprintf(defaultProcesses, sizeof(defaultProcesses), "%d", reader.config.processCount);
+    snprintf(defaultPages, sizeof(defaultPages), "%d", reader.config.pagesPerProcess);
+    processText = defaultProcesses;
+    pageText = defaultPages;
+    workloadText = tracePath;
+  }
+
+  List policies = parseList(policyText);
+  List frames = parseList(frameText);
+  List workloads = tracePath != NULL ? parseList("trace") : parseList(workloadText);
+  List processes = parseList(processText);
+  List pages = parseList(pageText);
+  List tlbs = parseList(tlbText);
+  List pools = parseList(poolText);
+
+  int count = policies.count * frames.count * workloads.count * processes.count * pages.count * tlbs.count *
+    pools.count;
+  Point* points = malloc(sizeof(Point) * count);
+  PointResult* results = calloc(count, sizeof(PointResult));
+  Job* running = malloc(sizeof(Job) * jobs);
+  if (points == NULL || results == NULL || running == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+
+  // Lay the grid out and check every point before running any of them
+  int n = 0;
+  int a, b, c, d, e, f, g;
+  for (a = 0; a < policies.count; a++) {
+    if (!selectReplacementPolicy(policies.items[a])) {
+      fprintf(stderr, "Unknown policy %s\n", policies.items[a]);
+      exit(1);
+    }
+    if (replacementPolicy == &optPolicy && (tracePath == NULL || prefetchConfig.window > 0 || base.sharedPages > 0)) {
+      fprintf(stderr, "The opt policy needs a trace (-r) and no read-ahead (-A) or shared pages\n");
+      exit(1);
+    }
+    for (b = 0; b < workloads.count; b++) {
+      WorkloadConfig workload = workloadBase;
+      if (tracePath == NULL && !parseWorkload(workloads.items[b], &workload)) {
+        fprintf(stderr, "Unknown workload %s\n", workloads.items[b]);
+        exit(1);
+      }
+      for (c = 0; c < processes.count; c++) {
+        for (d = 0; d < pages.count; d++) {
+          for (e = 0; e < frames.count; e++) {
+            for (f = 0; f < tlbs.count; f++) {
+              for (g = 0; g < pools.count; g++) {
+                Point* point = &points[n++];
+                point->policy = policies.items[a];
+                point->workload = tracePath != NULL ? tracePath : workloads.items[b];
+                point->processes = listInt(&processes, c);
+                point->pages = listInt(&pages, d);
+                point->frames = listInt(&frames, e);
+                point->tlbEntries = listInt(&tlbs, f);
+                point->pool = pools.items[g];
+
+                PagingConfig config = pointConfig(point, &base);
+                TlbConfig tlb = tlbConfig;
+                tlb.entries = point->tlbEntries;
+                if (tlb.ways > tlb.entries && tlb.entries > 0) tlb.ways = tlb.entries;
+                ZswapConfig pool;
+                if (!parseZswapConfig(point->pool, &pool)) {
+                  fprintf(stderr, "Bad compressed pool %s\n", point->pool);
+                  exit(1);
+                }
+                if (!checkPagingConfig(&config) || !checkTlbConfig(&tlb) ||
+                  !checkPrefetchConfig(&prefetchConfig, &config) || !checkZswapConfig(&pool) ||
+                  (tracePath == NULL && !checkWorkloadConfig(&workload, config.pagesPerProcess))) {
+                  exit(1);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  if (curveRate > 0) {
+    // The curve treats every process's pages as its own
+    if (base.sharedPages > 0) {
+      fprintf(stderr, "Miss ratio curves (-M) can't be computed with shared pages\n");
+      exit(1);
+    }
+    bool json;
+    FILE* out = openOutput(outputPath, &json);
+    bool ok = writeCurves(out, json, &workloads, &processes, &pages, &frames, framesGiven, &base, &workloadBase,
+      tracePath != NULL ? &reader : NULL, tracePath, seed, references, curveRate);
+    if (out != stdout) fclose(out);
+    if (tracePath != NULL) closeTraceReader(&reader);
+    return ok ? 0 : 1;
+  }
+
+  // Keep jobs workers busy, each running one point in a child of its own so the policy
+  // and TLB globals start fresh
+  int next = 0;
+  int active = 0;
+  int finished = 0;
+  bool failed = false;
+  bool showProgress = isatty(STDERR_FILENO);
+  while (finished < count) {
+    while (active < jobs && next < count) {
+      int fds[2];
+      if (pipe(fds) == -1) {
+        perror("pipe");
+        exit(1);
+      }
+      pid_t pid = fork();
+      if (pid < 0) {
+        perror("fork");
+        exit(1);
+      }
+      if (pid == 0) {
+        close(fds[0]);
+        runPoint(&points[next], &base, &workloadBase, tracePath != NULL ? &reader : NULL, seed, references, fds[1]);
+      }
+      close(fds[1]);
+      running[active].pid = pid;
+      running[active].point = next;
+      running[active].fd = fds[0];
+      active++;
+      next++;
+    }
+
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      perror("waitpid");
+      exit(1);
+    }
+    int i;
+    for (i = 0; i < active && running[i].pid != pid; i++);
+    if (i == active) continue;
+
+    Job job = running[i];
+    running[i] = running[--active];
+    PointResult* result = &results[job.point];
+    if (read(job.fd, result, sizeof(PointResult)) != sizeof(PointResult) || !result->ok) {
+      fprintf(stderr, "Point %d (%s, %d frames, %s) failed\n", job.point, points[job.point].policy,
+        points[job.point].frames, points[job.point].workload);
+      result->ok = false;
+      failed = true;
+    }
+    close(job.fd);
+    finished++;
+    if (showProgress) fprintf(stderr, "\r%d/%d points", finished, count);
+  }
+  if (showProgress) fprintf(stderr, "\n");
+
+  bool json;
+  FILE* out = openOutput(outputPath, &json);
+  writeTable(out, json, points, results, count);
+  if (out != stdout) fclose(out);
+
+  if (tracePath != NULL) closeTraceReader(&reader);
+  return failed ? 1 : 0;
+}
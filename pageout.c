@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "policy.h"
+#include "log.h"
+#include "pageout.h"
+
+// Page-out daemon and the simulated disk it writes dirty pages to. The daemon wakes when
+// a fault leaves the free pool under the low watermark and asks the replacement policy
+// for victims until the pool, together with the frames being written back, reaches the
+// high watermark. Clean victims go straight back to the pool. Dirty victims are unmapped
+// and written out in the background, pages that are adjacent in the same process
+// sharing one I/O, and their frames are freed when the write completes.
+
+PageOutConfig pageOutConfig;
+
+// A dirty page picked by the daemon, before it is grouped into I/Os
+typedef struct {
+  int process;
+  long long page;
+  int frame;
+} WriteBackPage;
+
+// Writes in flight, in the order the disk finishes them: the frames of every queued
+// write back to back, and the number of frames in each write
+int* writeBackFrames;
+int* writeBackSizes;
+int writeBackCapacity;
+int writeBackFrameHead;
+int writeBackFrameCount;
+int writeBackHead;
+int writeBackCount;
+WriteBackPage* writeBackBatch;
+
+// Simulated time the disk finishes the last write queued on it
+unsigned long long diskFreeAt;
+
+// Parse "low,high" watermarks from the command line
+bool parsePageOutConfig(const char* text, PageOutConfig* config) {
+  return sscanf(text, "%d,%d", &config->low, &config->high) == 2;
+}
+
+// Check that the watermarks are usable, printing the problem if they aren't. At least
+// half the frames always hold pages, so a victim can always be found.
+bool checkPageOutConfig(const PageOutConfig* config, int frameCount) {
+  if (config->high == 0) return true;
+  if (config->low < 1 || config->high <= config->low || config->high > frameCount / 2) {
+    fprintf(stderr, "Page-out watermarks need 0 < low < high <= %d\n", frameCount / 2);
+    return false;
+  }
+  return true;
+}
+
+bool initPageOut(int frameCount) {
+  freePageOut();
+  diskFreeAt = 0;
+  if (pageOutConfig.high == 0) return true;
+
+  writeBackFrames = malloc(sizeof(int) * frameCount);
+  writeBackSizes = malloc(sizeof(int) * frameCount);
+  writeBackBatch = malloc(sizeof(WriteBackPage) * frameCount);
+  if (writeBackFrames == NULL || writeBackSizes == NULL || writeBackBatch == NULL) {
+    perror("malloc");
+    freePageOut();
+    return false;
+  }
+  writeBackCapacity = frameCount;
+  writeBackFrameHead = 0;
+  writeBackFrameCount = 0;
+  writeBackHead = 0;
+  writeBackCount = 0;
+  return true;
+}
+
+void freePageOut() {
+  free(writeBackFrames);
+  free(writeBackSizes);
+  free(writeBackBatch);
+  writeBackFrames = NULL;
+  writeBackSizes = NULL;
+  writeBackBatch = NULL;
+}
+
+bool pageOutEnabled() {
+  return writeBackFrames != NULL;
+}
+
+// Queue a write of count pages on the disk, returning when it will finish
+unsigned long long queueDiskWrite(unsigned long long now, int count) {
+  unsigned long long start = diskFreeAt > now ? diskFreeAt : now;
+  diskFreeAt = start + DISK_WRITE_NANOS + (unsigned long long)(count - 1) * DISK_CLUSTER_PAGE_NANOS;
+  return diskFreeAt;
+}
+
+// Write count dirty victims out on the faulting request's path, in one I/O. Returns when
+// the write finishes and the frames can be read into.
+unsigned long long writeBackNow(unsigned long long now, int count) {
+  return queueDiskWrite(now, count);
+}
+
+int compareWriteBackPages(const void* a, const void* b) {
+  const WriteBackPage* x = (const WriteBackPage*)a;
+  const WriteBackPage* y = (const WriteBackPage*)b;
+  if (x->process != y->process) return x->process < y->process ? -1 : 1;
+  if (x->page != y->page) return x->page < y->page ? -1 : 1;
+  return 0;
+}
+
+// Group the dirty pages the daemon picked into one I/O per run of adjacent pages of a
+// process and queue them on the disk. Returns the number of I/Os.
+int submitWriteBacks(int count, EventQueue* events, sclock_t* clock) {
+  qsort(writeBackBatch, count, sizeof(WriteBackPage), compareWriteBackPages);
+
+  int ios = 0;
+  int start = 0;
+  while (start < count) {
+    int end = start + 1;
+    while (end < count && writeBackBatch[end].process == writeBackBatch[start].process &&
+      writeBackBatch[end].page == writeBackBatch[end - 1].page + 1) {
+      end++;
+    }
+
+    int i;
+    for (i = start; i < end; i++) {
+      writeBackFrames[(writeBackFrameHead + writeBackFrameCount) % writeBackCapacity] = writeBackBatch[i].frame;
+      writeBackFrameCount++;
+    }
+    writeBackSizes[(writeBackHead + writeBackCount) % writeBackCapacity] = end - start;
+    writeBackCount++;
+    scheduleEvent(events, queueDiskWrite(clock_to_nano(*clock), end - start), EVENT_WRITEBACK_DONE, -1, -1);
+
+    ios++;
+    start = end;
+  }
+  return ios;
+}
+
+// Reclaim frames ahead of demand if the free pool has fallen below the low watermark
+void runPageOut(FrameTable* frameTable, PageTable* pageTables, EventQueue* events, sclock_t* clock, StatsBlock* stats) {
+  if (writeBackFrames == NULL || frameTable->freeCount >= pageOutConfig.low) return;
+
+  // Frames already being written back will be free soon
+  int target = pageOutConfig.high - frameTable->freeCount - writeBackFrameCount;
+  if (target <= 0) return;
+
+  int freed = 0;
+  int dirtyCount = 0;
+  int attempts;
+  for (attempts = 0; freed + dirtyCount < target && attempts < 2 * frameTable->frameCount; attempts++) {
+    int victim = replacementPolicy->chooseVictim(frameTable, -1, -1);
+    FrameOwner* owner = &(frameTable->owners[victim]);
+    // Policies that sweep every frame can land on one that holds no page
+    if (owner->process == -1) continue;
+
+    bool dirty = frameBit(frameTable->dirty, victim);
+    if (dirty) {
+      writeBackBatch[dirtyCount].process = owner->process;
+      writeBackBatch[dirtyCount].page = owner->page;
+      writeBackBatch[dirtyCount].frame = victim;
+      dirtyCount++;
+    }
+
+    resetPageAtFrame(frameTable, victim, pageTables);
+    if (replacementPolicy->removed != NULL) {
+      replacementPolicy->removed(frameTable, victim);
+    }
+    if (dirty) {
+      // Held out of the free pool until the disk has the page
+      clearFrameBit(frameTable->dirty, victim);
+      clearFrameBit(frameTable->referenced, victim);
+      frameTable->frames[victim].reference_byte = 0;
+    } else {
+      releaseFrame(frameTable, victim);
+      freed++;
+    }
+  }
+
+  int ios = submitWriteBacks(dirtyCount, events, clock);
+  statsPageOut(stats, freed, dirtyCount, ios);
+  logEvent(LOG_PAGEOUT, clock, freed, dirtyCount, ios);
+}
+
+// The disk finished the oldest queued write: its frames can be used again
+void finishWriteBack(FrameTable* frameTable) {
+  if (writeBackCount == 0) return;
+
+  int count = writeBackSizes[writeBackHead];
+  writeBackHead = (writeBackHead + 1) % writeBackCapacity;
+  writeBackCount--;
+
+  int i;
+  for (i = 0; i < count; i++) {
+    releaseFrame(frameTable, writeBackFrames[writeBackFrameHead]);
+    writeBackFrameHead = (writeBackFrameHead + 1) % writeBackCapacity;
+    writeBackFrameCount--;
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef PAGEOUT_H
+#define PAGEOUT_H
+
+#include <stdbool.h>
+
+#include "structs.h"
+#include "events.h"
+#include "stats.h"
+
+// Simulated time for the disk to read a page in, to write one out, and to write each
+// further page of a cluster in the same I/O
+#define DISK_READ_NANOS 14000000
+#define DISK_WRITE_NANOS 14000000
+#define DISK_CLUSTER_PAGE_NANOS 100000
+
+// Free-frame watermarks for the page-out daemon. Once a fault leaves fewer than low
+// frames free, the daemon evicts pages until high frames are free or on their way to it.
+// high is 0 when the daemon is off.
+typedef struct {
+  int low;
+  int high;
+} PageOutConfig;
+
+extern PageOutConfig pageOutConfig;
+
+bool parsePageOutConfig(const char* text, PageOutConfig* config);
+bool checkPageOutConfig(const PageOutConfig* config, int frameCount);
+
+bool initPageOut(int frameCount);
+void freePageOut();
+bool pageOutEnabled();
+
+unsigned long long writeBackNow(unsigned long long now, int count);
+void runPageOut(FrameTable* frameTable, PageTable* pageTables, EventQueue* events, sclock_t* clock, StatsBlock* stats);
+void finishWriteBack(FrameTable* frameTable);
+
+#endif /* PAGEOUT_H */
@@ -0,0 +1,483 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "log.h"
+#include "parallel.h"
+
+// Parallel memory manager: each worker thread serves the process slots s with
+// s % workerCount == its index, straight from the request rings. The frames are split
+// into shards on bitmap word boundaries, each with its own lock, free pool and CLOCK
+// hand. A worker faults pages into its own shard, steals free frames from the others
+// when its pool is empty, and otherwise evicts with its own hand. Read hits take no
+// lock at all: they only read the page table and set the referenced bit atomically.
+// Faults go back to the main loop, which still owns the simulated clock, the event
+// queue and process launches.
+
+// A slice of the frame table guarded by one lock
+typedef struct {
+  pthread_mutex_t lock;
+  int first;     // first frame of the shard, a multiple of FRAME_WORD_BITS
+  int end;       // one past the last frame
+  int hand;      // CLOCK hand, between first and end
+  int freeCount; // frames in the shard's free pool
+} __attribute__((aligned(64))) FrameShard;
+
+typedef struct {
+  pthread_t thread;
+  Transport transport; // serves this worker's slots and sleeps on its own doorbell
+  FrameShard* shard;   // where this worker's faults are served from
+} Worker;
+
+Worker* workers;
+int workerCount;
+FrameShard* shards;
+int shardCount;
+_Atomic bool workersStopping;
+
+FrameTable* parallelFrameTable;
+PageTable* parallelPageTables;
+StatsBlock* parallelStats;
+
+// Simulated time as last published by the main loop, and time the workers have spent
+// serving requests since the main loop last collected it
+_Atomic unsigned long long engineNanos;
+_Atomic unsigned long long workerNanos;
+
+// Fault notices waiting for the main loop, double buffered so it can take them all at once
+pthread_mutex_t faultLock = PTHREAD_MUTEX_INITIALIZER;
+FaultNotice* faultNotices[2];
+int faultNoticeCount;
+int faultNoticeCapacity[2];
+int faultNoticeBuffer;
+
+// The main loop sleeps on this when every running process is busy with the workers
+_Atomic unsigned int mainDoorbell;
+_Atomic unsigned int mainSleeping;
+
+FrameShard* shardOf(int frameNumber) {
+  int i;
+  for (i = shardCount - 1; i > 0; i--) {
+    if (frameNumber >= shards[i].first) break;
+  }
+  return &shards[i];
+}
+
+void setReferenced(int frameNumber) {
+  __atomic_fetch_or(&parallelFrameTable->referenced[frameNumber / FRAME_WORD_BITS],
+    1ULL << (frameNumber % FRAME_WORD_BITS), __ATOMIC_RELAXED);
+}
+
+void clearReferenced(int frameNumber) {
+  __atomic_fetch_and(&parallelFrameTable->referenced[frameNumber / FRAME_WORD_BITS],
+    ~(1ULL << (frameNumber % FRAME_WORD_BITS)), __ATOMIC_RELAXED);
+}
+
+// Take a frame from a shard's free pool, or -1 if it has none. Caller holds the lock.
+int takeShardFrame(FrameShard* shard) {
+  if (shard->freeCount == 0) return -1;
+
+  FrameTable* frameTable = parallelFrameTable;
+  int word;
+  for (word = shard->first / FRAME_WORD_BITS; word * FRAME_WORD_BITS < shard->end; word++) {
+    if (frameTable->freeFrames[word] != 0) {
+      int frameNumber = word * FRAME_WORD_BITS + __builtin_ctzll(frameTable->freeFrames[word]);
+      clearFrameBit(frameTable->freeFrames, frameNumber);
+      __atomic_store_n(&shard->freeCount, shard->freeCount - 1, __ATOMIC_RELAXED);
+      return frameNumber;
+    }
+  }
+  return -1;
+}
+
+// Sweep a shard's CLOCK hand to an unreferenced frame, a word at a time. Referenced bits
+// are cleared with atomic ANDs because read hits set them without the lock.
+int sweepShard(FrameShard* shard) {
+  uint64_t* referenced = parallelFrameTable->referenced;
+  int frame = shard->hand;
+  while (true) {
+    int word = frame / FRAME_WORD_BITS;
+    int first = frame % FRAME_WORD_BITS;
+    int last = shard->end - word * FRAME_WORD_BITS;
+    uint64_t range = (last >= FRAME_WORD_BITS ? ~0ULL : (1ULL << last) - 1) & ~((1ULL << first) - 1);
+
+    uint64_t unreferenced = ~__atomic_load_n(&referenced[word], __ATOMIC_RELAXED) & range;
+    if (unreferenced != 0) {
+      int found = __builtin_ctzll(unreferenced);
+      __atomic_fetch_and(&referenced[word], ~(range & ((1ULL << found) - 1)), __ATOMIC_RELAXED);
+      frame = word * FRAME_WORD_BITS + found;
+      shard->hand = frame + 1 < shard->end ? frame + 1 : shard->first;
+      return frame;
+    }
+
+    __atomic_fetch_and(&referenced[word], ~range, __ATOMIC_RELAXED);
+    frame = (word + 1) * FRAME_WORD_BITS;
+    if (frame >= shard->end) frame = shard->first;
+  }
+}
+
+// Map a page into a frame taken from its shard. Caller holds the shard's lock.
+void mapFrame(int frameNumber, int pageTableIndex, long long pageNumber) {
+  FrameTable* frameTable = parallelFrameTable;
+  frameTable->owners[frameNumber].process = pageTableIndex;
+  frameTable->owners[frameNumber].page = pageNumber;
+  clearFrameBit(frameTable->dirty, frameNumber);
+  clearReferenced(frameNumber);
+  __atomic_store_n(&pageEntry(parallelPageTables, pageTableIndex, pageNumber)->frame, frameNumber, __ATOMIC_RELEASE);
+}
+
+// Lock-free hit path. A read only needs the page table entry; a write also takes the
+// frame's shard lock so the dirty bit can't land on a page that replaced this one.
+bool tryHit(int slot, long long pageNumber, bool isRead, AccessResult* result) {
+  Page* entry = findPageEntry(parallelPageTables, slot, pageNumber);
+  if (entry == NULL) return false;
+  int frameNumber = __atomic_load_n(&entry->frame, __ATOMIC_ACQUIRE);
+  if (frameNumber == -1) return false;
+
+  if (!isRead) {
+    FrameShard* shard = shardOf(frameNumber);
+    pthread_mutex_lock(&shard->lock);
+    if (__atomic_load_n(&entry->frame, __ATOMIC_ACQUIRE) != frameNumber) {
+      // Evicted by another worker in the meantime
+      pthread_mutex_unlock(&shard->lock);
+      return false;
+    }
+    setFrameBit(parallelFrameTable->dirty, frameNumber);
+    pthread_mutex_unlock(&shard->lock);
+  }
+  setReferenced(frameNumber);
+
+  result->frame = frameNumber;
+  result->fault = false;
+  result->evicted = false;
+  result->evictedDirty = false;
+  result->tlbHit = false;
+  result->copied = false;
+  result->evictedProcess = -1;
+  result->evictedPage = -1;
+  return true;
+}
+
+// Bring a page in for a worker: from its own shard's pool, from another shard's pool,
+// or by evicting from its own shard
+void faultPage(Worker* worker, int slot, long long pageNumber, AccessResult* result) {
+  FrameShard* own = worker->shard;
+  result->fault = true;
+  result->evicted = false;
+  result->evictedDirty = false;
+  result->tlbHit = false;
+  result->copied = false;
+  result->evictedProcess = -1;
+  result->evictedPage = -1;
+
+  pthread_mutex_lock(&own->lock);
+  int frameNumber = takeShardFrame(own);
+  if (frameNumber != -1) {
+    mapFrame(frameNumber, slot, pageNumber);
+    pthread_mutex_unlock(&own->lock);
+    result->frame = frameNumber;
+    return;
+  }
+
+  // Steal from shards that aren't busy; never block on a second lock while holding ours
+  int i;
+  for (i = 0; i < shardCount; i++) {
+    FrameShard* other = &shards[i];
+    if (other == own || __atomic_load_n(&other->freeCount, __ATOMIC_RELAXED) == 0) continue;
+    if (pthread_mutex_trylock(&other->lock) != 0) continue;
+
+    frameNumber = takeShardFrame(other);
+    if (frameNumber != -1) mapFrame(frameNumber, slot, pageNumber);
+    pthread_mutex_unlock(&other->lock);
+    if (frameNumber != -1) {
+      pthread_mutex_unlock(&own->lock);
+      result->frame = frameNumber;
+      return;
+    }
+  }
+
+  // Every pool is empty: evict from our own shard
+  frameNumber = sweepShard(own);
+  FrameOwner* owner = &(parallelFrameTable->owners[frameNumber]);
+  result->evicted = true;
+  result->evictedDirty = frameBit(parallelFrameTable->dirty, frameNumber);
+  result->evictedProcess = owner->process;
+  result->evictedPage = owner->page;
+  __atomic_store_n(&findPageEntry(parallelPageTables, owner->process, owner->page)->frame, -1, __ATOMIC_RELEASE);
+  mapFrame(frameNumber, slot, pageNumber);
+  pthread_mutex_unlock(&own->lock);
+  result->frame = frameNumber;
+}
+
+// Hand a fault to the main loop and wake it if it is asleep
+void postFault(const MemoryRequest* reply, int slot) {
+  pthread_mutex_lock(&faultLock);
+  int buffer = faultNoticeBuffer;
+  if (faultNoticeCount == faultNoticeCapacity[buffer]) {
+    int capacity = faultNoticeCapacity[buffer] * 2;
+    FaultNotice* grown = realloc(faultNotices[buffer], sizeof(FaultNotice) * capacity);
+    if (grown == NULL) {
+      perror("realloc");
+      exit(1);
+    }
+    faultNotices[buffer] = grown;
+    faultNoticeCapacity[buffer] = capacity;
+  }
+  faultNotices[buffer][faultNoticeCount].reply = *reply;
+  faultNotices[buffer][faultNoticeCount].slot = slot;
+  faultNoticeCount++;
+  pthread_mutex_unlock(&faultLock);
+
+  atomic_fetch_add(&mainDoorbell, 1);
+  if (atomic_load(&mainSleeping)) {
+    syscall(SYS_futex, &mainDoorbell, FUTEX_WAKE, 1, NULL, NULL, 0);
+  }
+}
+
+// Serve one request the way the serial main loop does: reference by reference until one
+// of them faults
+void serveRequest(Worker* worker, MemoryRequest* request, int slot) {
+  unsigned long long now = atomic_load_explicit(&engineNanos, memory_order_relaxed);
+  sclock_t clock;
+  clock.seconds = now / 1000000000ULL;
+  clock.nanoseconds = now % 1000000000ULL;
+  unsigned long long nanos = 5000;
+
+  request->status = REQUEST_DONE;
+  for (request->completed = 0; request->completed < request->count && request->status == REQUEST_DONE;
+    request->completed++) {
+    uint64_t address = request->addresses[request->completed];
+    bool isRead = (request->reads >> request->completed) & 1;
+    logEvent(LOG_REQUEST, &clock, request->pid, isRead, address);
+
+    long long pageNumber = address >> parallelPageTables->pageShift;
+    AccessResult result;
+    if (!tryHit(slot, pageNumber, isRead, &result)) {
+      faultPage(worker, slot, pageNumber, &result);
+    }
+    statsAccess(parallelStats, slot, isRead, &result, &clock);
+
+    if (result.fault) {
+      logEvent(LOG_FAULT, &clock, address, 0, 0);
+      request->status = REQUEST_FAULTED;
+      continue;
+    }
+
+    nanos += 100;
+    increment_clock(&clock, 100);
+    if (isRead) {
+      logEvent(LOG_HIT_READ, &clock, address, result.frame, request->pid);
+    } else {
+      logEvent(LOG_HIT_WRITE, &clock, address, result.frame, 0);
+    }
+  }
+  atomic_fetch_add_explicit(&workerNanos, nanos, memory_order_relaxed);
+
+  // The reply carries no references back
+  request->count = 0;
+  if (request->status == REQUEST_FAULTED) {
+    postFault(request, slot);
+  } else {
+    sendResponse(&worker->transport, request, slot);
+  }
+}
+
+// Every worker logs to a ring of its own
+_Static_assert(MAX_WORKERS <= LOG_MAX_WORKERS, "the log needs a ring for every worker");
+
+void* workerMain(void* arg) {
+  Worker* worker = (Worker*)arg;
+
+  // Leave signals to the main thread
+  sigset_t signals;
+  sigfillset(&signals);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+  attachLog(worker - workers);
+
+  MemoryRequest request;
+  int slot;
+  while (!atomic_load(&workersStopping)) {
+    if (!receiveRequest(&worker->transport, &request, &slot)) {
+      unsigned int ticket = prepareWait(&worker->transport);
+      if (atomic_load(&workersStopping)) {
+        cancelWait(&worker->transport);
+        break;
+      }
+      if (!waitForRequest(&worker->transport, ticket, &request, &slot)) continue;
+    }
+    serveRequest(worker, &request, slot);
+  }
+  return NULL;
+}
+
+// Split the frame table into shards and start the workers. The frame table must be
+// freshly initialized, with every frame free.
+bool startWorkers(int count, Transport* transport, FrameTable* frameTable, PageTable* pageTables,
+  StatsBlock* stats) {
+  parallelFrameTable = frameTable;
+  parallelPageTables = pageTables;
+  parallelStats = stats;
+  atomic_store(&workersStopping, false);
+  atomic_store(&engineNanos, 0);
+  atomic_store(&workerNanos, 0);
+
+  // Shards cover whole bitmap words so no two shards' frames share a word
+  shardCount = count < frameTable->wordCount ? count : frameTable->wordCount;
+  shards = calloc(shardCount, sizeof(FrameShard));
+  workers = calloc(count, sizeof(Worker));
+  Transport* consumers = calloc(count, sizeof(Transport));
+  faultNoticeCapacity[0] = faultNoticeCapacity[1] = 64;
+  faultNotices[0] = malloc(sizeof(FaultNotice) * faultNoticeCapacity[0]);
+  faultNotices[1] = malloc(sizeof(FaultNotice) * faultNoticeCapacity[1]);
+  if (shards == NULL || workers == NULL || consumers == NULL || faultNotices[0] == NULL || faultNotices[1] == NULL) {
+    perror("calloc");
+    return false;
+  }
+  faultNoticeCount = 0;
+  faultNoticeBuffer = 0;
+
+  int i;
+  for (i = 0; i < shardCount; i++) {
+    FrameShard* shard = &shards[i];
+    pthread_mutex_init(&shard->lock, NULL);
+    shard->first = (int)((long long)frameTable->wordCount * i / shardCount) * FRAME_WORD_BITS;
+    shard->end = (int)((long long)frameTable->wordCount * (i + 1) / shardCount) * FRAME_WORD_BITS;
+    if (shard->end > frameTable->frameCount) shard->end = frameTable->frameCount;
+    shard->hand = shard->first;
+    shard->freeCount = shard->end - shard->first;
+  }
+
+  // Logging and the statistics totals now have several writers
+  if (!shareLog(count)) {
+    return false;
+  }
+  shareStats();
+
+  splitTransport(transport, consumers, count);
+  workerCount = count;
+  for (i = 0; i < count; i++) {
+    workers[i].transport = consumers[i];
+    workers[i].shard = &shards[i % shardCount];
+    if (pthread_create(&workers[i].thread, NULL, workerMain, &workers[i]) != 0) {
+      perror("pthread_create");
+      return false;
+    }
+  }
+  free(consumers);
+  return true;
+}
+
+// Stop and join the workers. Only called once no process is left to send requests.
+void stopWorkers() {
+  atomic_store(&workersStopping, true);
+  int i;
+  for (i = 0; i < workerCount; i++) {
+    wakeTransport(&workers[i].transport);
+  }
+  for (i = 0; i < workerCount; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  for (i = 0; i < shardCount; i++) {
+    pthread_mutex_destroy(&shards[i].lock);
+  }
+
+  free(workers);
+  free(shards);
+  free(faultNotices[0]);
+  free(faultNotices[1]);
+  workers = NULL;
+  shards = NULL;
+  workerCount = 0;
+  shardCount = 0;
+}
+
+bool workersRunning() {
+  return workerCount > 0;
+}
+
+// Let the workers see the main loop's simulated clock
+void publishClock(const sclock_t* clock) {
+  atomic_store_explicit(&engineNanos, clock_to_nano(*clock), memory_order_relaxed);
+}
+
+// Collect the simulated time the workers have spent serving requests
+unsigned long long takeWorkerNanos() {
+  return atomic_exchange_explicit(&workerNanos, 0, memory_order_relaxed);
+}
+
+// Take every fault notice posted so far. The array stays valid until the next call.
+int takeFaultNotices(FaultNotice** notices) {
+  pthread_mutex_lock(&faultLock);
+  int count = faultNoticeCount;
+  *notices = faultNotices[faultNoticeBuffer];
+  faultNoticeBuffer = 1 - faultNoticeBuffer;
+  faultNoticeCount = 0;
+  pthread_mutex_unlock(&faultLock);
+  return count;
+}
+
+// Sleep until a worker posts a fault or the timeout passes. The main loop wakes up
+// regularly anyway, since hits advance the clock without telling it.
+void waitForWorkers(unsigned int timeoutNanos) {
+  atomic_store(&mainSleeping, 1);
+  unsigned int ticket = atomic_load(&mainDoorbell);
+
+  pthread_mutex_lock(&faultLock);
+  bool pending = faultNoticeCount > 0;
+  pthread_mutex_unlock(&faultLock);
+
+  if (!pending) {
+    struct timespec timeout;
+    timeout.tv_sec = timeoutNanos / 1000000000U;
+    timeout.tv_nsec = timeoutNanos % 1000000000U;
+    syscall(SYS_futex, &mainDoorbell, FUTEX_WAIT, ticket, &timeout, NULL, 0);
+  }
+  atomic_store(&mainSleeping, 0);
+}
+
+// Free the frames of a terminated process. Workers may be evicting its pages at the same
+// time, so each frame is released under its shard's lock if the page still owns it. With
+// no huge pages only the pages the process uses can be mapped.
+void parallelRemoveProcessPages(int pageTableIndex) {
+  FrameTable* frameTable = parallelFrameTable;
+  const PagingConfig* config = &parallelPageTables->config;
+  int i;
+  for (i = 0; i < config->pagesPerProcess; i++) {
+    Page* entry = findPageEntry(parallelPageTables, pageTableIndex, processPageNumber(config, i));
+    if (entry == NULL) continue;
+    int frameNumber = __atomic_load_n(&entry->frame, __ATOMIC_ACQUIRE);
+    if (frameNumber == -1) continue;
+
+    FrameShard* shard = shardOf(frameNumber);
+    pthread_mutex_lock(&shard->lock);
+    if (__atomic_load_n(&entry->frame, __ATOMIC_ACQUIRE) == frameNumber) {
+      __atomic_store_n(&entry->frame, -1, __ATOMIC_RELEASE);
+      frameTable->owners[frameNumber].process = -1;
+      frameTable->owners[frameNumber].page = -1;
+      clearFrameBit(frameTable->dirty, frameNumber);
+      clearReferenced(frameNumber);
+      setFrameBit(frameTable->freeFrames, frameNumber);
+      __atomic_store_n(&shard->freeCount, shard->freeCount + 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&shard->lock);
+  }
+  freeProcessPageTable(parallelPageTables, pageTableIndex);
+}
+
+// Log the frame table with every shard locked so the dump is consistent
+void parallelLogFrameTable(const sclock_t* clock) {
+  int i;
+  for (i = 0; i < shardCount; i++) {
+    pthread_mutex_lock(&shards[i].lock);
+  }
+  logFrameTable(parallelFrameTable, clock);
+  for (i = shardCount - 1; i >= 0; i--) {
+    pthread_mutex_unlock(&shards[i].lock);
+  }
+}
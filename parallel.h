@@ -0,0 +1,32 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdbool.h>
+
+#include "structs.h"
+#include "transport.h"
+#include "stats.h"
+
+#define MAX_WORKERS TRANSPORT_MAX_CONSUMERS
+
+// A worker found a page fault; the main loop blocks the process until the page is in
+// and then sends it the reply
+typedef struct {
+  MemoryRequest reply;
+  int slot;
+} FaultNotice;
+
+bool startWorkers(int workerCount, Transport* transport, FrameTable* frameTable, PageTable* pageTables,
+  StatsBlock* stats);
+void stopWorkers();
+bool workersRunning();
+
+void publishClock(const sclock_t* clock);
+unsigned long long takeWorkerNanos();
+int takeFaultNotices(FaultNotice** notices);
+void waitForWorkers(unsigned int timeoutNanos);
+
+void parallelRemoveProcessPages(int pageTableIndex);
+void parallelLogFrameTable(const sclock_t* clock);
+
+#endif /* PARALLEL_H */
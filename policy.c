@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "policy.h"
+
+const ReplacementPolicy* replacementPolicy = &clockPolicy;
+
+const ReplacementPolicy* policies[] = {
+  &clockPolicy,
+  &agingPolicy,
+  &wsclockPolicy,
+  &clockProPolicy,
+  &arcPolicy,
+  &optPolicy
+};
+
+#define POLICY_COUNT (int)(sizeof(policies) / sizeof(policies[0]))
+
+// Make the named policy the active one, returning false if there is no such policy
+bool selectReplacementPolicy(const char* name) {
+  int i;
+  for (i = 0; i < POLICY_COUNT; i++) {
+    if (strcmp(policies[i]->name, name) == 0) {
+      replacementPolicy = policies[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+// Names of all policies separated by '|', for usage messages
+const char* replacementPolicyNames() {
+  static char names[128];
+  if (names[0] != '\0') return names;
+
+  int i;
+  for (i = 0; i < POLICY_COUNT; i++) {
+    if (i > 0) strcat(names, "|");
+    strcat(names, policies[i]->name);
+  }
+  return names;
+}
+
+// Hash bucket for a page
+int ghostBucket(const GhostList* list, int process, long long page) {
+  unsigned int hash = (unsigned int)process * 2654435761U ^ (unsigned int)(page ^ page >> 32) * 40503U;
+  return hash % list->bucketCount;
+}
+
+// Initialize an empty ghost list that remembers at most capacity pages
+void initGhostList(GhostList* list, int capacity) {
+  list->capacity = capacity > 0 ? capacity : 1;
+  list->bucketCount = list->capacity * 2;
+  list->entries = malloc(sizeof(GhostEntry) * list->capacity);
+  list->buckets = malloc(sizeof(int) * list->bucketCount);
+  if (list->entries == NULL || list->buckets == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+
+  int i;
+  for (i = 0; i < list->bucketCount; i++) {
+    list->buckets[i] = -1;
+  }
+  // Chain every entry onto the free list
+  for (i = 0; i < list->capacity; i++) {
+    list->entries[i].next = i + 1 < list->capacity ? i + 1 : -1;
+  }
+  list->freeList = 0;
+  list->size = 0;
+  list->oldest = -1;
+  list->newest = -1;
+}
+
+void freeGhostList(GhostList* list) {
+  free(list->entries);
+  free(list->buckets);
+  list->entries = NULL;
+  list->buckets = NULL;
+  list->size = 0;
+}
+
+// Find the entry for a page, or -1 if it isn't in the list
+int ghostFind(const GhostList* list, int process, long long page) {
+  int i = list->buckets[ghostBucket(list, process, page)];
+  while (i != -1) {
+    if (list->entries[i].process == process && list->entries[i].page == page) return i;
+    i = list->entries[i].hashNext;
+  }
+  return -1;
+}
+
+bool ghostContains(const GhostList* list, int process, long long page) {
+  return ghostFind(list, process, page) != -1;
+}
+
+// Unlink an entry from the age order and its hash chain and return it to the free list
+void ghostUnlink(GhostList* list, int i) {
+  GhostEntry* entry = &(list->entries[i]);
+
+  if (entry->prev != -1) list->entries[entry->prev].next = entry->next;
+  else list->oldest = entry->next;
+  if (entry->next != -1) list->entries[entry->next].prev = entry->prev;
+  else list->newest = entry->prev;
+
+  int* link = &(list->buckets[ghostBucket(list, entry->process, entry->page)]);
+  while (*link != i) {
+    link = &(list->entries[*link].hashNext);
+  }
+  *link = entry->hashNext;
+
+  entry->next = list->freeList;
+  list->freeList = i;
+  list->size--;
+}
+
+// Remove a page from the list, returning false if it wasn't there
+bool ghostRemove(GhostList* list, int process, long long page) {
+  int i = ghostFind(list, process, page);
+  if (i == -1) return false;
+  ghostUnlink(list, i);
+  return true;
+}
+
+// Drop the oldest page, returning false if the list is empty
+bool ghostPopOldest(GhostList* list) {
+  if (list->oldest == -1) return false;
+  ghostUnlink(list, list->oldest);
+  return true;
+}
+
+// Add a page as the newest entry, dropping the oldest one if the list is full
+void ghostPush(GhostList* list, int process, long long page) {
+  if (list->size == list->capacity) ghostPopOldest(list);
+
+  int i = list->freeList;
+  GhostEntry* entry = &(list->entries[i]);
+  list->freeList = entry->next;
+
+  entry->process = process;
+  entry->page = page;
+  entry->prev = list->newest;
+  entry->next = -1;
+  if (list->newest != -1) list->entries[list->newest].next = i;
+  else list->oldest = i;
+  list->newest = i;
+
+  int bucket = ghostBucket(list, process, page);
+  entry->hashNext = list->buckets[bucket];
+  list->buckets[bucket] = i;
+  list->size++;
+}
+
+// Remove every page belonging to a process
+void ghostRemoveProcess(GhostList* list, int process) {
+  int i = list->oldest;
+  while (i != -1) {
+    int next = list->entries[i].next;
+    if (list->entries[i].process == process) ghostUnlink(list, i);
+    i = next;
+  }
+}
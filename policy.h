@@ -0,0 +1,72 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stdbool.h>
+
+#include "structs.h"
+#include "trace.h"
+
+// A page replacement policy. replacePage() always fills free frames first and only
+// asks the policy for a victim when every frame is occupied.
+typedef struct {
+  const char* name;
+  // Reset the policy's state for an empty frame table
+  void (*init)(FrameTable* frameTable);
+  // A resident page was referenced
+  void (*accessed)(FrameTable* frameTable, int frameNumber);
+  // Pick an occupied frame to evict so the given page can be brought in
+  int (*chooseVictim)(FrameTable* frameTable, int process, long long page);
+  // A page was brought into a frame (counts as a reference to it)
+  void (*inserted)(FrameTable* frameTable, int frameNumber, int process, long long page);
+  // A frame was freed because its process terminated
+  void (*removed)(FrameTable* frameTable, int frameNumber);
+  // A process terminated; forget any history kept for its pages
+  void (*processRemoved)(int process);
+} ReplacementPolicy;
+
+extern const ReplacementPolicy* replacementPolicy;
+
+extern const ReplacementPolicy clockPolicy;
+extern const ReplacementPolicy agingPolicy;
+extern const ReplacementPolicy wsclockPolicy;
+extern const ReplacementPolicy clockProPolicy;
+extern const ReplacementPolicy arcPolicy;
+extern const ReplacementPolicy optPolicy;
+
+bool selectReplacementPolicy(const char* name);
+const char* replacementPolicyNames();
+
+// The opt policy looks ahead in the trace being replayed, which has to be indexed first
+bool loadOptIndex(const TraceReader* reader, const PagingConfig* config);
+void freeOptIndex();
+
+// History of non-resident pages, used by ARC and CLOCK-Pro to recognize pages that
+// were evicted recently. Entries are kept oldest to newest and found by hashing.
+typedef struct {
+  int process;
+  long long page;
+  int prev;
+  int next;
+  int hashNext;
+} GhostEntry;
+
+typedef struct {
+  GhostEntry* entries;
+  int* buckets;
+  int bucketCount;
+  int capacity;
+  int size;
+  int oldest;
+  int newest;
+  int freeList;
+} GhostList;
+
+void initGhostList(GhostList* list, int capacity);
+void freeGhostList(GhostList* list);
+bool ghostContains(const GhostList* list, int process, long long page);
+bool ghostRemove(GhostList* list, int process, long long page);
+void ghostPush(GhostList* list, int process, long long page);
+bool ghostPopOldest(GhostList* list);
+void ghostRemoveProcess(GhostList* list, int process);
+
+#endif /* POLICY_H */
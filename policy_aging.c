@@ -0,0 +1,74 @@
+#include <stddef.h>
+
+#include "policy.h"
+
+// Aging (NFU with decay): reference_byte is an 8-bit age counter. A reference sets its
+// top bit and every AGING_INTERVAL references all counters shift right one place, so
+// the frame with the smallest counter holds the least recently and frequently used page.
+// The referenced bitmap records which frames were used since the last shift.
+
+#define AGING_INTERVAL 64
+
+int agingReferences;
+
+// Count a reference and age every frame once per interval
+void agingTick(FrameTable* frameTable) {
+  if (++agingReferences % AGING_INTERVAL != 0) return;
+
+  int i;
+  for (i = 0; i < frameTable->frameCount; i++) {
+    frameTable->frames[i].reference_byte >>= 1;
+  }
+  for (i = 0; i < frameTable->wordCount; i++) {
+    frameTable->referenced[i] = 0;
+  }
+}
+
+void agingInit(FrameTable* frameTable) {
+  frameTable->headIndex = 0;
+  agingReferences = 0;
+}
+
+void agingAccessed(FrameTable* frameTable, int frameNumber) {
+  frameTable->frames[frameNumber].reference_byte |= 0x80;
+  setFrameBit(frameTable->referenced, frameNumber);
+  agingTick(frameTable);
+}
+
+int agingChooseVictim(FrameTable* frameTable, int process, long long page) {
+  (void)process;
+  (void)page;
+
+  // Start the scan at the last victim so ties don't always land on the same frames.
+  // Frames holding no page, such as ones being written back, always have the smallest
+  // counter and are passed over.
+  int victim = -1;
+  int i;
+  for (i = 0; i < frameTable->frameCount; i++) {
+    int index = (frameTable->headIndex + i) % frameTable->frameCount;
+    if (frameTable->owners[index].process == -1) continue;
+    if (victim == -1 || frameTable->frames[index].reference_byte < frameTable->frames[victim].reference_byte) {
+      victim = index;
+    }
+  }
+  frameTable->headIndex = (victim + 1) % frameTable->frameCount;
+  return victim;
+}
+
+void agingInserted(FrameTable* frameTable, int frameNumber, int process, long long page) {
+  (void)process;
+  (void)page;
+  frameTable->frames[frameNumber].reference_byte = 0x80;
+  setFrameBit(frameTable->referenced, frameNumber);
+  agingTick(frameTable);
+}
+
+const ReplacementPolicy agingPolicy = {
+  "aging",
+  agingInit,
+  agingAccessed,
+  agingChooseVictim,
+  agingInserted,
+  NULL,
+  NULL
+};
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "policy.h"
+
+// ARC (Adaptive Replacement Cache): T1 holds pages referenced once recently and T2 pages
+// referenced at least twice, both in LRU order. B1 and B2 remember pages recently evicted
+// from T1 and T2. A fault on a page in B1 grows arcTarget, the share of frames given to
+// T1; a fault on a page in B2 shrinks it.
+
+#define ARC_NONE 0
+#define ARC_T1 1
+#define ARC_T2 2
+
+// Frames in LRU order, oldest at head
+typedef struct {
+  int head;
+  int tail;
+  int size;
+} FrameList;
+
+int* arcPrev;
+int* arcNext;
+int* arcList;
+FrameList arcT1;
+FrameList arcT2;
+GhostList arcB1;
+GhostList arcB2;
+int arcTarget;
+int arcCapacity;
+
+// Page whose ghost hit has already adjusted arcTarget during the current fault
+int arcAdaptedProcess;
+long long arcAdaptedPage;
+
+FrameList* arcListFor(int which) {
+  return which == ARC_T1 ? &arcT1 : &arcT2;
+}
+
+void arcUnlink(int frameNumber) {
+  if (arcList[frameNumber] == ARC_NONE) return;
+  FrameList* list = arcListFor(arcList[frameNumber]);
+
+  if (arcPrev[frameNumber] != -1) arcNext[arcPrev[frameNumber]] = arcNext[frameNumber];
+  else list->head = arcNext[frameNumber];
+  if (arcNext[frameNumber] != -1) arcPrev[arcNext[frameNumber]] = arcPrev[frameNumber];
+  else list->tail = arcPrev[frameNumber];
+
+  list->size--;
+  arcList[frameNumber] = ARC_NONE;
+}
+
+// Make a frame the most recently used entry of T1 or T2
+void arcAppend(int which, int frameNumber) {
+  arcUnlink(frameNumber);
+  FrameList* list = arcListFor(which);
+
+  arcPrev[frameNumber] = list->tail;
+  arcNext[frameNumber] = -1;
+  if (list->tail != -1) arcNext[list->tail] = frameNumber;
+  else list->head = frameNumber;
+  list->tail = frameNumber;
+
+  list->size++;
+  arcList[frameNumber] = which;
+}
+
+// Adjust arcTarget for a fault on a page found in one of the ghost lists
+void arcAdapt(int process, long long page) {
+  if (process == arcAdaptedProcess && page == arcAdaptedPage) return;
+  arcAdaptedProcess = process;
+  arcAdaptedPage = page;
+
+  if (ghostContains(&arcB1, process, page)) {
+    int delta = arcB2.size > arcB1.size ? arcB2.size / arcB1.size : 1;
+    arcTarget = arcTarget + delta < arcCapacity ? arcTarget + delta : arcCapacity;
+  } else if (ghostContains(&arcB2, process, page)) {
+    int delta = arcB1.size > arcB2.size ? arcB1.size / arcB2.size : 1;
+    arcTarget = arcTarget - delta > 0 ? arcTarget - delta : 0;
+  }
+}
+
+// Evict the LRU page of T1 or T2 into its ghost list, as in ARC's REPLACE routine
+int arcReplace(FrameTable* frameTable, bool inB2) {
+  int victim;
+  if (arcT1.size > 0 && (arcT1.size > arcTarget || (inB2 && arcT1.size == arcTarget) || arcT2.size == 0)) {
+    victim = arcT1.head;
+    ghostPush(&arcB1, frameTable->owners[victim].process, frameTable->owners[victim].page);
+  } else {
+    victim = arcT2.head;
+    ghostPush(&arcB2, frameTable->owners[victim].process, frameTable->owners[victim].page);
+  }
+  arcUnlink(victim);
+  return victim;
+}
+
+void arcInit(FrameTable* frameTable) {
+  int n = frameTable->frameCount;
+  arcCapacity = n;
+  arcTarget = 0;
+  arcAdaptedProcess = -1;
+  arcAdaptedPage = -1;
+
+  free(arcPrev);
+  free(arcNext);
+  free(arcList);
+  arcPrev = malloc(sizeof(int) * n);
+  arcNext = malloc(sizeof(int) * n);
+  arcList = calloc(n, sizeof(int));
+  if (arcPrev == NULL || arcNext == NULL || arcList == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+
+  arcT1.head = arcT1.tail = -1;
+  arcT1.size = 0;
+  arcT2.head = arcT2.tail = -1;
+  arcT2.size = 0;
+
+  freeGhostList(&arcB1);
+  freeGhostList(&arcB2);
+  initGhostList(&arcB1, n);
+  initGhostList(&arcB2, n);
+}
+
+void arcAccessed(FrameTable* frameTable, int frameNumber) {
+  setFrameBit(frameTable->referenced, frameNumber);
+  arcAppend(ARC_T2, frameNumber);
+}
+
+int arcChooseVictim(FrameTable* frameTable, int process, long long page) {
+  arcAdapt(process, page);
+  bool inB1 = ghostContains(&arcB1, process, page);
+  bool inB2 = ghostContains(&arcB2, process, page);
+
+  if (!inB1 && !inB2) {
+    if (arcT1.size + arcB1.size >= arcCapacity) {
+      // L1 is full: drop B1's oldest page, or if B1 is empty evict T1's LRU page outright
+      if (arcT1.size < arcCapacity) {
+        ghostPopOldest(&arcB1);
+      } else {
+        int victim = arcT1.head;
+        arcUnlink(victim);
+        return victim;
+      }
+    } else if (arcT1.size + arcT2.size + arcB1.size + arcB2.size >= 2 * arcCapacity) {
+      ghostPopOldest(&arcB2);
+    }
+  }
+
+  return arcReplace(frameTable, inB2);
+}
+
+void arcInserted(FrameTable* frameTable, int frameNumber, int process, long long page) {
+  setFrameBit(frameTable->referenced, frameNumber);
+  arcAdapt(process, page);
+  arcAdaptedProcess = -1;
+  arcAdaptedPage = -1;
+
+  // Pages seen recently enough to be in a ghost list have now been used twice
+  if (ghostRemove(&arcB1, process, page) || ghostRemove(&arcB2, process, page)) {
+    arcAppend(ARC_T2, frameNumber);
+  } else {
+    arcAppend(ARC_T1, frameNumber);
+  }
+}
+
+void arcRemoved(FrameTable* frameTable, int frameNumber) {
+  (void)frameTable;
+  arcUnlink(frameNumber);
+}
+
+void arcProcessRemoved(int process) {
+  ghostRemoveProcess(&arcB1, process);
+  ghostRemoveProcess(&arcB2, process);
+}
+
+const ReplacementPolicy arcPolicy = {
+  "arc",
+  arcInit,
+  arcAccessed,
+  arcChooseVictim,
+  arcInserted,
+  arcRemoved,
+  arcProcessRemoved
+};
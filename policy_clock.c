@@ -0,0 +1,41 @@
+#include <stddef.h>
+
+#include "policy.h"
+
+// Second chance (CLOCK): the hand sweeps the frames, clearing reference bits, and
+// evicts the first frame whose page hasn't been referenced since the last sweep. The
+// sweep works on the frame table's referenced bitmap a word at a time.
+
+void clockInit(FrameTable* frameTable) {
+  frameTable->headIndex = 0;
+}
+
+void clockAccessed(FrameTable* frameTable, int frameNumber) {
+  setFrameBit(frameTable->referenced, frameNumber);
+}
+
+int clockChooseVictim(FrameTable* frameTable, int process, long long page) {
+  (void)process;
+  (void)page;
+
+  // Give referenced pages a second chance
+  int index = sweepReferenced(frameTable, frameTable->headIndex);
+  frameTable->headIndex = (index + 1) % frameTable->frameCount;
+  return index;
+}
+
+void clockInserted(FrameTable* frameTable, int frameNumber, int process, long long page) {
+  (void)process;
+  (void)page;
+  setFrameBit(frameTable->referenced, frameNumber);
+}
+
+const ReplacementPolicy clockPolicy = {
+  "clock",
+  clockInit,
+  clockAccessed,
+  clockChooseVictim,
+  clockInserted,
+  NULL,
+  NULL
+};
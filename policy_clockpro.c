@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "policy.h"
+
+// CLOCK-Pro: resident pages are hot or cold. The cold hand (headIndex) evicts cold pages
+// that weren't referenced; a cold page referenced during its test period is promoted to
+// hot. Evicted pages still in their test period are remembered as non-resident, and a
+// fault on one of them means the cold allocation was too small, so coldTarget grows.
+// The hot hand demotes unreferenced hot pages to keep hotCount <= frameCount - coldTarget,
+// and ends test periods as it passes, shrinking coldTarget. The non-resident list holds
+// at most frameCount pages and drops the oldest, standing in for the paper's test hand.
+
+bool* clockProHot;
+bool* clockProTest;
+int clockProHotCount;
+int clockProColdTarget;
+int clockProHotHand;
+GhostList clockProNonResident;
+
+// Sweep the hot hand until hot pages fit in the space left over by the cold target
+void clockProRunHotHand(FrameTable* frameTable) {
+  int limit = frameTable->frameCount - clockProColdTarget;
+
+  while (clockProHotCount > limit) {
+    int index = clockProHotHand;
+    clockProHotHand = (index + 1) % frameTable->frameCount;
+
+    if (frameBit(frameTable->freeFrames, index)) continue;
+
+    if (clockProHot[index]) {
+      if (frameBit(frameTable->referenced, index)) {
+        clearFrameBit(frameTable->referenced, index);
+      } else {
+        clockProHot[index] = false;
+        clockProTest[index] = false;
+        clockProHotCount--;
+      }
+    } else if (clockProTest[index]) {
+      // The test period ran out without a reuse, so cold pages need less room
+      clockProTest[index] = false;
+      if (clockProColdTarget > 1) {
+        clockProColdTarget--;
+        limit++;
+      }
+    }
+  }
+}
+
+// Make a page hot after it was reused within its test period
+void clockProPromote(FrameTable* frameTable, int frameNumber) {
+  clockProHot[frameNumber] = true;
+  clockProTest[frameNumber] = false;
+  clockProHotCount++;
+  if (clockProColdTarget < frameTable->frameCount - 1) clockProColdTarget++;
+  clockProRunHotHand(frameTable);
+}
+
+void clockProInit(FrameTable* frameTable) {
+  frameTable->headIndex = 0;
+  clockProHotHand = 0;
+  clockProHotCount = 0;
+  clockProColdTarget = 1;
+
+  free(clockProHot);
+  free(clockProTest);
+  clockProHot = calloc(frameTable->frameCount, sizeof(bool));
+  clockProTest = calloc(frameTable->frameCount, sizeof(bool));
+  if (clockProHot == NULL || clockProTest == NULL) {
+    perror("calloc");
+    exit(1);
+  }
+
+  freeGhostList(&clockProNonResident);
+  initGhostList(&clockProNonResident, frameTable->frameCount);
+}
+
+void clockProAccessed(FrameTable* frameTable, int frameNumber) {
+  setFrameBit(frameTable->referenced, frameNumber);
+}
+
+int clockProChooseVictim(FrameTable* frameTable, int process, long long page) {
+  (void)process;
+  (void)page;
+
+  while (true) {
+    int index = frameTable->headIndex;
+    frameTable->headIndex = (index + 1) % frameTable->frameCount;
+
+    if (clockProHot[index]) continue;
+
+    if (frameBit(frameTable->referenced, index)) {
+      clearFrameBit(frameTable->referenced, index);
+      if (clockProTest[index]) {
+        clockProPromote(frameTable, index);
+      } else {
+        clockProTest[index] = true;
+      }
+      continue;
+    }
+
+    // Keep remembering the page if it is still being tested
+    if (clockProTest[index]) {
+      FrameOwner* owner = &(frameTable->owners[index]);
+      ghostPush(&clockProNonResident, owner->process, owner->page);
+    }
+    clockProTest[index] = false;
+    return index;
+  }
+}
+
+void clockProInserted(FrameTable* frameTable, int frameNumber, int process, long long page) {
+  clearFrameBit(frameTable->referenced, frameNumber);
+  clockProHot[frameNumber] = false;
+  clockProTest[frameNumber] = true;
+
+  // Faulted again within its test period: the page belongs in the hot set
+  if (ghostRemove(&clockProNonResident, process, page)) {
+    clockProPromote(frameTable, frameNumber);
+  }
+}
+
+void clockProRemoved(FrameTable* frameTable, int frameNumber) {
+  (void)frameTable;
+  if (clockProHot[frameNumber]) clockProHotCount--;
+  clockProHot[frameNumber] = false;
+  clockProTest[frameNumber] = false;
+}
+
+void clockProProcessRemoved(int process) {
+  ghostRemoveProcess(&clockProNonResident, process);
+}
+
+const ReplacementPolicy clockProPolicy = {
+  "clockpro",
+  clockProInit,
+  clockProAccessed,
+  clockProChooseVictim,
+  clockProInserted,
+  clockProRemoved,
+  clockProProcessRemoved
+};
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "policy.h"
+
+// Belady's OPT: evict the page whose next reference is furthest in the future. It needs
+// the whole reference stream up front, so it only runs on a trace. loadOptIndex() makes
+// one backward pass over the trace to find, for every access, when the same page is next
+// referenced, and the policy keeps the resident frames in a max-heap on that time. Each
+// reference reaches the policy as exactly one accessed() or inserted() call, so counting
+// those calls tells it which access of the trace it is at.
+
+#define OPT_NEVER UINT32_MAX
+
+// Access number of the next reference to the same page, for every access of the trace
+uint32_t* optNextUse;
+uint32_t optAccessCount;
+uint32_t optCursor;
+
+// Max-heap of resident frames on the time of their next reference
+int* optHeap;
+int* optPosition;   // where each frame is in the heap, -1 if it isn't
+uint32_t* optKey;
+int optHeapSize;
+
+// The page an access of the trace was to, while the index is built
+typedef struct {
+  int slot;
+  uint32_t generation;  // pages of an earlier process in the slot are different pages
+  long long page;
+  uint32_t next;        // the latest access to it seen so far, going backwards
+} OptPage;
+
+OptPage* optPages;
+int optPageMask;
+int optPageCount;
+
+// Hash table slot holding a page, or the empty one where it would go
+int findOptPage(int slot, long long page) {
+  uint64_t hash = ((uint64_t)page * 0x9e3779b97f4a7c15ULL) ^ ((uint64_t)slot * 0xc2b2ae3d27d4eb4fULL);
+  int index = (int)((hash >> 32) & optPageMask);
+  while (optPages[index].slot != -1 && (optPages[index].slot != slot || optPages[index].page != page)) {
+    index = (index + 1) & optPageMask;
+  }
+  return index;
+}
+
+// Double the page table once it is half full
+bool growOptPages() {
+  OptPage* old = optPages;
+  int oldSize = optPageMask + 1;
+  optPages = malloc(sizeof(OptPage) * oldSize * 2);
+  if (optPages == NULL) {
+    perror("malloc");
+    optPages = old;
+    return false;
+  }
+  optPageMask = oldSize * 2 - 1;
+  int i;
+  for (i = 0; i <= optPageMask; i++) {
+    optPages[i].slot = -1;
+  }
+  for (i = 0; i < oldSize; i++) {
+    if (old[i].slot != -1) optPages[findOptPage(old[i].slot, old[i].page)] = old[i];
+  }
+  free(old);
+  return true;
+}
+
+// Index the accesses of a trace for the opt policy. Only the next-use table, 4 bytes an
+// access, grows with the trace; the pages seen while building it are bounded by the
+// address spaces of the processes in it. Returns false if the trace can't be used.
+bool loadOptIndex(const TraceReader* reader, const PagingConfig* config) {
+  freeOptIndex();
+  if (config->hugePages) {
+    fprintf(stderr, "The opt policy can't replay with huge pages\n");
+    return false;
+  }
+  // A shared page's next use is the nearest one by any of the processes sharing it, and
+  // a copy on write makes one reference both use a page and insert another
+  if (config->sharedPages > 0) {
+    fprintf(stderr, "The opt policy can't replay with shared pages\n");
+    return false;
+  }
+
+  size_t count = 0;
+  size_t i;
+  for (i = 0; i < reader->recordCount; i++) {
+    if (reader->records[i].type == TRACE_ACCESS) count++;
+  }
+  if (count >= OPT_NEVER) {
+    fprintf(stderr, "The opt policy can't replay more than %u accesses\n", OPT_NEVER - 1);
+    return false;
+  }
+
+  uint32_t* generations = calloc(config->processCount, sizeof(uint32_t));
+  optNextUse = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+  optPageMask = 1023;
+  optPages = malloc(sizeof(OptPage) * (optPageMask + 1));
+  if (generations == NULL || optNextUse == NULL || optPages == NULL) {
+    perror("malloc");
+    free(generations);
+    freeOptIndex();
+    return false;
+  }
+  for (i = 0; i <= (size_t)optPageMask; i++) {
+    optPages[i].slot = -1;
+  }
+  optPageCount = 0;
+  optAccessCount = (uint32_t)count;
+
+  // Going backwards, an exit starts the references of an earlier process in its slot
+  int pageShift = __builtin_ctz(config->pageSize);
+  uint32_t access = optAccessCount;
+  bool ok = true;
+  for (i = reader->recordCount; i-- > 0 && ok;) {
+    const TraceRecord* record = &(reader->records[i]);
+    if (record->slot >= config->processCount) continue;
+    if (record->type == TRACE_EXIT) {
+      generations[record->slot]++;
+      continue;
+    }
+
+    access--;
+    long long page = record->address >> pageShift;
+    OptPage* entry = &optPages[findOptPage(record->slot, page)];
+    if (entry->slot == -1) {
+      entry->slot = record->slot;
+      entry->page = page;
+      optPageCount++;
+    } else if (entry->generation == generations[record->slot]) {
+      optNextUse[access] = entry->next;
+      entry->next = access;
+      continue;
+    }
+    optNextUse[access] = OPT_NEVER;
+    entry->generation = generations[record->slot];
+    entry->next = access;
+    if (2 * optPageCount > optPageMask) ok = growOptPages();
+  }
+
+  free(generations);
+  free(optPages);
+  optPages = NULL;
+  if (!ok) freeOptIndex();
+  return ok;
+}
+
+void freeOptIndex() {
+  free(optNextUse);
+  optNextUse = NULL;
+  optAccessCount = 0;
+}
+
+void optSwap(int a, int b) {
+  int frame = optHeap[a];
+  optHeap[a] = optHeap[b];
+  optHeap[b] = frame;
+  optPosition[optHeap[a]] = a;
+  optPosition[optHeap[b]] = b;
+}
+
+// Restore the heap around a position whose frame's key changed
+void optFix(int position) {
+  while (position > 0 && optKey[optHeap[(position - 1) / 2]] < optKey[optHeap[position]]) {
+    optSwap(position, (position - 1) / 2);
+    position = (position - 1) / 2;
+  }
+  while (true) {
+    int largest = position;
+    int left = 2 * position + 1;
+    int right = left + 1;
+    if (left < optHeapSize && optKey[optHeap[left]] > optKey[optHeap[largest]]) largest = left;
+    if (right < optHeapSize && optKey[optHeap[right]] > optKey[optHeap[largest]]) largest = right;
+    if (largest == position) return;
+    optSwap(position, largest);
+    position = largest;
+  }
+}
+
+void optInit(FrameTable* frameTable) {
+  int n = frameTable->frameCount;
+  free(optHeap);
+  free(optPosition);
+  free(optKey);
+  optHeap = malloc(sizeof(int) * n);
+  optPosition = malloc(sizeof(int) * n);
+  optKey = malloc(sizeof(uint32_t) * n);
+  if (optHeap == NULL || optPosition == NULL || optKey == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  memset(optPosition, -1, sizeof(int) * n);
+  optHeapSize = 0;
+  optCursor = 0;
+}
+
+// The frame's page was referenced by the next access of the trace
+void optReferenced(int frameNumber) {
+  if (optCursor >= optAccessCount) {
+    fprintf(stderr, "The opt policy ran past the end of its trace\n");
+    exit(1);
+  }
+  optKey[frameNumber] = optNextUse[optCursor++];
+  if (optPosition[frameNumber] == -1) {
+    optPosition[frameNumber] = optHeapSize;
+    optHeap[optHeapSize++] = frameNumber;
+  }
+  optFix(optPosition[frameNumber]);
+}
+
+void optAccessed(FrameTable* frameTable, int frameNumber) {
+  (void)frameTable;
+  optReferenced(frameNumber);
+}
+
+int optChooseVictim(FrameTable* frameTable, int process, long long page) {
+  (void)frameTable;
+  (void)process;
+  (void)page;
+  return optHeap[0];
+}
+
+void optInserted(FrameTable* frameTable, int frameNumber, int process, long long page) {
+  (void)frameTable;
+  (void)process;
+  (void)page;
+  optReferenced(frameNumber);
+}
+
+void optRemoved(FrameTable* frameTable, int frameNumber) {
+  (void)frameTable;
+  int position = optPosition[frameNumber];
+  if (position == -1) return;
+  optSwap(position, --optHeapSize);
+  optPosition[frameNumber] = -1;
+  if (position < optHeapSize) optFix(position);
+}
+
+const ReplacementPolicy optPolicy = {
+  "opt",
+  optInit,
+  optAccessed,
+  optChooseVictim,
+  optInserted,
+  optRemoved,
+  NULL
+};
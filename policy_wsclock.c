@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "policy.h"
+
+// WSClock: the hand sweeps like CLOCK, but a page is only evicted once it has fallen
+// out of the working set, i.e. it hasn't been referenced for WSCLOCK_WINDOW references.
+// Old clean pages are taken first. There is no writeback to schedule from here, so an
+// old dirty page keeps its dirty bit and is only taken when no old clean page is
+// found; its write is then paid for like any other dirty eviction.
+
+#define WSCLOCK_WINDOW 2000
+
+unsigned long long wsclockTime;
+unsigned long long* wsclockLastUse;
+
+void wsclockInit(FrameTable* frameTable) {
+  frameTable->headIndex = 0;
+  wsclockTime = 0;
+
+  free(wsclockLastUse);
+  wsclockLastUse = calloc(frameTable->frameCount, sizeof(unsigned long long));
+  if (wsclockLastUse == NULL) {
+    perror("calloc");
+    exit(1);
+  }
+}
+
+void wsclockAccessed(FrameTable* frameTable, int frameNumber) {
+  wsclockTime++;
+  setFrameBit(frameTable->referenced, frameNumber);
+  wsclockLastUse[frameNumber] = wsclockTime;
+}
+
+int wsclockChooseVictim(FrameTable* frameTable, int process, long long page) {
+  (void)process;
+  (void)page;
+
+  int firstOldDirty = -1;
+  int firstClean = -1;
+  int firstOwned = -1;
+  int i;
+  // Two laps: pages whose referenced bit the first lap cleared can be taken on the second
+  for (i = 0; i < 2 * frameTable->frameCount; i++) {
+    int index = frameTable->headIndex;
+    frameTable->headIndex = (index + 1) % frameTable->frameCount;
+
+    // Frames holding no page, such as ones the page-out daemon is writing back, are
+    // not candidates
+    if (frameTable->owners[index].process == -1) continue;
+    if (firstOwned == -1) firstOwned = index;
+
+    if (frameBit(frameTable->referenced, index)) {
+      clearFrameBit(frameTable->referenced, index);
+      wsclockLastUse[index] = wsclockTime;
+      continue;
+    }
+
+    if (wsclockTime - wsclockLastUse[index] > WSCLOCK_WINDOW) {
+      if (!frameBit(frameTable->dirty, index)) return index;
+      if (firstOldDirty == -1) firstOldDirty = index;
+      continue;
+    }
+
+    if (firstClean == -1 && !frameBit(frameTable->dirty, index)) firstClean = index;
+  }
+
+  // No old clean page: take an old dirty one and write it out. If everything is in
+  // some working set, take a clean page, or the first one the hand passed.
+  if (firstOldDirty != -1) return firstOldDirty;
+  if (firstClean != -1) return firstClean;
+  return firstOwned;
+}
+
+void wsclockInserted(FrameTable* frameTable, int frameNumber, int process, long long page) {
+  (void)process;
+  (void)page;
+  wsclockAccessed(frameTable, frameNumber);
+}
+
+const ReplacementPolicy wsclockPolicy = {
+  "wsclock",
+  wsclockInit,
+  wsclockAccessed,
+  wsclockChooseVictim,
+  wsclockInserted,
+  NULL,
+  NULL
+};
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "zswap.h"
+#include "prefetch.h"
+
+// Read-ahead. Each slot remembers the page and stride of its last fault; a fault one
+// stride further on means the process is scanning, so the pages the scan will reach next
+// are brought in with the faulting one, in the same I/O. The window starts small,
+// doubles every fault that continues the scan, and halves whenever a page read ahead for
+// the slot is evicted before it was used.
+
+PrefetchConfig prefetchConfig;
+
+// Per slot: where the last fault (or the read-ahead after it) left off and the window
+// the next read-ahead uses
+long long* prefetchLastPage;
+long long* prefetchStride;
+int* prefetchWindow;
+// Bumped when the process in a slot terminates, so pages it read ahead are no longer
+// charged to the slot
+unsigned int* prefetchGeneration;
+
+// Per frame: whether its page was read ahead and hasn't been used yet, and for whom
+uint64_t* prefetchUnused;
+int* prefetchSlot;
+unsigned int* prefetchFrameGeneration;
+
+// Check that the read-ahead window is usable, printing the problem if it isn't. One
+// read-ahead can't take more than a quarter of memory, and huge pages already bring in
+// whole runs of pages on their own.
+bool checkPrefetchConfig(const PrefetchConfig* config, const PagingConfig* paging) {
+  if (config->window == 0) return true;
+  if (config->window < 0 || config->window > paging->frameCount / 4) {
+    fprintf(stderr, "The read-ahead window must be between 0 and %d pages\n", paging->frameCount / 4);
+    return false;
+  }
+  if (paging->hugePages) {
+    fprintf(stderr, "Read-ahead can't be used with huge pages\n");
+    return false;
+  }
+  return true;
+}
+
+// Window of a slot's first read-ahead
+int initialPrefetchWindow() {
+  return PREFETCH_INITIAL_WINDOW < prefetchConfig.window ? PREFETCH_INITIAL_WINDOW : prefetchConfig.window;
+}
+
+bool initPrefetch(int processCount, int frameCount) {
+  freePrefetch();
+  if (prefetchConfig.window == 0) return true;
+
+  prefetchLastPage = malloc(sizeof(long long) * processCount);
+  prefetchStride = calloc(processCount, sizeof(long long));
+  prefetchWindow = malloc(sizeof(int) * processCount);
+  prefetchGeneration = calloc(processCount, sizeof(unsigned int));
+  prefetchUnused = calloc((frameCount + FRAME_WORD_BITS - 1) / FRAME_WORD_BITS, sizeof(uint64_t));
+  prefetchSlot = malloc(sizeof(int) * frameCount);
+  prefetchFrameGeneration = malloc(sizeof(unsigned int) * frameCount);
+  if (prefetchLastPage == NULL || prefetchStride == NULL || prefetchWindow == NULL || prefetchGeneration == NULL ||
+    prefetchUnused == NULL || prefetchSlot == NULL || prefetchFrameGeneration == NULL) {
+    perror("malloc");
+    freePrefetch();
+    return false;
+  }
+
+  int slot;
+  for (slot = 0; slot < processCount; slot++) {
+    prefetchLastPage[slot] = -1;
+    prefetchWindow[slot] = initialPrefetchWindow();
+  }
+  return true;
+}
+
+void freePrefetch() {
+  free(prefetchLastPage);
+  free(prefetchStride);
+  free(prefetchWindow);
+  free(prefetchGeneration);
+  free(prefetchUnused);
+  free(prefetchSlot);
+  free(prefetchFrameGeneration);
+  prefetchLastPage = NULL;
+  prefetchStride = NULL;
+  prefetchWindow = NULL;
+  prefetchGeneration = NULL;
+  prefetchUnused = NULL;
+  prefetchSlot = NULL;
+  prefetchFrameGeneration = NULL;
+}
+
+bool prefetchEnabled() {
+  return prefetchUnused != NULL;
+}
+
+// A page was just brought into a frame. If the frame held a page read ahead that was
+// never used, the read-ahead overshot and its slot's window shrinks.
+void prefetchFilled(int frame, PrefetchResult* result) {
+  if (!frameBit(prefetchUnused, frame)) return;
+  clearFrameBit(prefetchUnused, frame);
+
+  int slot = prefetchSlot[frame];
+  if (prefetchFrameGeneration[frame] != prefetchGeneration[slot]) return;
+  result->wasted++;
+  prefetchWindow[slot] = prefetchWindow[slot] > 2 ? prefetchWindow[slot] / 2 : 1;
+}
+
+// Read ahead after a fault on pageNumber, which was brought into frame. Pages are only
+// read ahead within the leaf page table nodes the process already has, so a scan that
+// runs off the end of its address space stops there.
+PrefetchResult prefetchAfterFault(FrameTable* frameTable, PageTable* pageTables, int slot, long long pageNumber, int frame) {
+  PrefetchResult result = { 0, 0, 0, 0, 0 };
+  prefetchFilled(frame, &result);
+
+  long long stride = pageNumber - prefetchLastPage[slot];
+  bool scanning = prefetchLastPage[slot] != -1 && stride == prefetchStride[slot] && stride != 0 &&
+    llabs(stride) <= PREFETCH_MAX_STRIDE;
+  prefetchStride[slot] = stride;
+  prefetchLastPage[slot] = pageNumber;
+  if (!scanning) {
+    prefetchWindow[slot] = initialPrefetchWindow();
+    return result;
+  }
+
+  int window = prefetchWindow[slot];
+  long long page = pageNumber;
+  int i;
+  for (i = 0; i < window; i++) {
+    page += stride;
+    if (page < 0 || findPageEntry(pageTables, slot, page) == NULL) break;
+    prefetchLastPage[slot] = page;
+    if (lookupPage(pageTables, slot, page) != -1) continue;
+
+    AccessResult fill;
+    replacePage(frameTable, (uint64_t)page << pageTables->pageShift, pageTables, slot, &fill);
+    // A shared page another process has in memory is just mapped in
+    if (!fill.fault) continue;
+    prefetchFilled(fill.frame, &result);
+    setFrameBit(prefetchUnused, fill.frame);
+    prefetchSlot[fill.frame] = slot;
+    prefetchFrameGeneration[fill.frame] = prefetchGeneration[slot];
+    result.pages++;
+    if (fill.evicted) result.evictions++;
+    if (fill.evictedDirty) result.dirtyEvictions++;
+    result.diskWrites += zswapEvicted(&fill);
+  }
+  prefetchWindow[slot] = 2 * window < prefetchConfig.window ? 2 * window : prefetchConfig.window;
+
+  // A policy that doesn't favor new pages can give the faulting page's frame to its own
+  // read-ahead; the process still needs it
+  if (lookupPage(pageTables, slot, pageNumber) == -1) {
+    AccessResult fill;
+    replacePage(frameTable, (uint64_t)pageNumber << pageTables->pageShift, pageTables, slot, &fill);
+    prefetchFilled(fill.frame, &result);
+    if (fill.evicted) result.evictions++;
+    if (fill.evictedDirty) result.dirtyEvictions++;
+    result.diskWrites += zswapEvicted(&fill);
+  }
+  return result;
+}
+
+// A resident page was referenced. Returns true if it had been read ahead and this is its
+// first use.
+bool prefetchUsed(int frame) {
+  if (!frameBit(prefetchUnused, frame)) return false;
+  clearFrameBit(prefetchUnused, frame);
+  return true;
+}
+
+// The process in a slot terminated; the next one starts with no pattern
+void prefetchProcessRemoved(int slot) {
+  prefetchGeneration[slot]++;
+  prefetchLastPage[slot] = -1;
+  prefetchStride[slot] = 0;
+  prefetchWindow[slot] = initialPrefetchWindow();
+}
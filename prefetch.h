@@ -0,0 +1,41 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdbool.h>
+
+#include "structs.h"
+
+// Pages read ahead the first time a fault continues a pattern, before the window has
+// grown
+#define PREFETCH_INITIAL_WINDOW 2
+// Faults further apart than this many pages aren't taken for a strided scan
+#define PREFETCH_MAX_STRIDE 16
+
+// Read-ahead on faults. window is the most pages read in ahead of one fault, 0 when
+// read-ahead is off.
+typedef struct {
+  int window;
+} PrefetchConfig;
+
+// What the read-ahead after one fault did
+typedef struct {
+  int pages;          // pages brought in besides the faulting one
+  int evictions;      // resident pages displaced for them
+  int dirtyEvictions;
+  int diskWrites;     // dirty pages that have to be written out before the read
+  int wasted;         // read-ahead pages found evicted without ever being used
+} PrefetchResult;
+
+extern PrefetchConfig prefetchConfig;
+
+bool checkPrefetchConfig(const PrefetchConfig* config, const PagingConfig* paging);
+
+bool initPrefetch(int processCount, int frameCount);
+void freePrefetch();
+bool prefetchEnabled();
+
+PrefetchResult prefetchAfterFault(FrameTable* frameTable, PageTable* pageTables, int slot, long long pageNumber, int frame);
+bool prefetchUsed(int frame);
+void prefetchProcessRemoved(int slot);
+
+#endif /* PREFETCH_H */
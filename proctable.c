@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "structs.h"
+#include "proctable.h"
+
+// Per slot: the pid running in it, or -1
+int* pcb;
+int processSlotCount;
+// Bit set for every free slot
+uint64_t* freeSlots;
+// Open-addressed with linear probing: each bucket holds a slot, keyed by the pid in it,
+// or -1. There are at least twice as many buckets as slots, so probes stay short.
+int* pidIndex;
+int pidIndexMask;
+
+bool initProcessTable(int slotCount) {
+  freeProcessTable();
+
+  int buckets = 1;
+  while (buckets < 2 * slotCount) {
+    buckets *= 2;
+  }
+  int words = (slotCount + FRAME_WORD_BITS - 1) / FRAME_WORD_BITS;
+  pcb = malloc(sizeof(int) * slotCount);
+  freeSlots = calloc(words, sizeof(uint64_t));
+  pidIndex = malloc(sizeof(int) * buckets);
+  if (pcb == NULL || freeSlots == NULL || pidIndex == NULL) {
+    perror("malloc");
+    freeProcessTable();
+    return false;
+  }
+
+  int i;
+  for (i = 0; i < slotCount; i++) {
+    pcb[i] = -1;
+    setFrameBit(freeSlots, i);
+  }
+  for (i = 0; i < buckets; i++) {
+    pidIndex[i] = -1;
+  }
+  processSlotCount = slotCount;
+  pidIndexMask = buckets - 1;
+  return true;
+}
+
+void freeProcessTable() {
+  free(pcb);
+  free(freeSlots);
+  free(pidIndex);
+  pcb = NULL;
+  freeSlots = NULL;
+  pidIndex = NULL;
+}
+
+// Bucket a pid's probe starts at
+int pidBucket(int pid) {
+  return (int)(((uint32_t)pid * 2654435761U) >> 7) & pidIndexMask;
+}
+
+// Lowest free slot, or -1 if every slot has a process in it
+int freeProcessSlot() {
+  int words = (processSlotCount + FRAME_WORD_BITS - 1) / FRAME_WORD_BITS;
+  int i;
+  for (i = 0; i < words; i++) {
+    if (freeSlots[i] != 0) return i * FRAME_WORD_BITS + __builtin_ctzll(freeSlots[i]);
+  }
+  return -1;
+}
+
+// Put a new process in a free slot
+void assignProcess(int slot, int pid) {
+  pcb[slot] = pid;
+  clearFrameBit(freeSlots, slot);
+
+  int bucket = pidBucket(pid);
+  while (pidIndex[bucket] != -1) {
+    bucket = (bucket + 1) & pidIndexMask;
+  }
+  pidIndex[bucket] = slot;
+}
+
+// Bucket holding a pid's slot, or -1 if the pid isn't running
+int findPidBucket(int pid) {
+  int bucket = pidBucket(pid);
+  while (pidIndex[bucket] != -1) {
+    if (pcb[pidIndex[bucket]] == pid) return bucket;
+    bucket = (bucket + 1) & pidIndexMask;
+  }
+  return -1;
+}
+
+// Slot a process runs in, or -1 if it isn't running
+int findProcessSlot(int pid) {
+  int bucket = findPidBucket(pid);
+  return bucket != -1 ? pidIndex[bucket] : -1;
+}
+
+// Take a terminated process out of the table and return the slot it freed, or -1 if it
+// wasn't running. The entries probed past its bucket move back into the gap, so no
+// probe ever stops short of its pid.
+int clearProcess(int pid) {
+  int hole = findPidBucket(pid);
+  if (hole == -1) return -1;
+  int slot = pidIndex[hole];
+
+  int bucket = hole;
+  while (true) {
+    bucket = (bucket + 1) & pidIndexMask;
+    if (pidIndex[bucket] == -1) break;
+    int home = pidBucket(pcb[pidIndex[bucket]]);
+    // Move the entry back unless its probe starts after the hole
+    if (((bucket - home) & pidIndexMask) >= ((bucket - hole) & pidIndexMask)) {
+      pidIndex[hole] = pidIndex[bucket];
+      hole = bucket;
+    }
+  }
+  pidIndex[hole] = -1;
+
+  pcb[slot] = -1;
+  setFrameBit(freeSlots, slot);
+  return slot;
+}
+
+// Pid of the process in a slot, or -1 if the slot is free
+int processPid(int slot) {
+  return pcb[slot];
+}
+
+// This function prints all process IDs (pid) in the process control block (pcb).
+void printPIDs() {
+  int i;
+  // Iterate over the pcb array
+  for (i = 0; i < processSlotCount; i++) {
+    printf("%-5d ", pcb[i]); // Print each PID with a width of 5 characters
+    if ((i + 1) % 18 == 0) {
+      printf("\n"); // Print a new line after every 18 PIDs
+    }
+  }
+}
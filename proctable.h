@@ -0,0 +1,19 @@
+#ifndef PROCTABLE_H
+#define PROCTABLE_H
+
+#include <stdbool.h>
+
+// The process control block: the pid of the simulated process in each slot, -1 for a
+// free slot. A hash index from pid to slot finds the sender of a request without
+// scanning the slots, and a bitmap of free slots finds the lowest one for a launch.
+bool initProcessTable(int slotCount);
+void freeProcessTable();
+
+int freeProcessSlot();
+void assignProcess(int slot, int pid);
+int findProcessSlot(int pid);
+int clearProcess(int pid);
+int processPid(int slot);
+void printPIDs();
+
+#endif /* PROCTABLE_H */
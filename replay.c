@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "structs.h"
+#include "policy.h"
+#include "tlb.h"
+#include "trace.h"
+#include "prefetch.h"
+#include "zswap.h"
+#include "replay.h"
+
+// Paging engine run without user processes or IPC: a recorded trace replayed in order,
+// or a synthetic workload generated in the same process. Every access and process exit
+// goes through the same calls oss makes live.
+
+// Paging structures of an engine run. The policy and TLB settings come from the globals
+// oss uses.
+typedef struct {
+  PagingConfig config;
+  PageTable* pageTables;
+  FrameTable* frameTable;
+  ReplayCounts* counts;
+} Engine;
+
+bool openEngine(Engine* engine, const PagingConfig* config, ReplayCounts* counts) {
+  memset(counts, 0, sizeof(ReplayCounts));
+  engine->config = *config;
+  engine->counts = counts;
+  engine->pageTables = calloc(1, pageTablesSize(config));
+  engine->frameTable = calloc(1, frameTableSize(config->frameCount));
+  if (engine->pageTables == NULL || engine->frameTable == NULL) {
+    perror("calloc");
+    return false;
+  }
+  initializePageTables(engine->pageTables, config);
+  initializeFrameTable(engine->frameTable, config->frameCount);
+  return initTlb(config->processCount) && initPrefetch(config->processCount, config->frameCount) &&
+    initZswap(config->processCount, config->pageSize);
+}
+
+void closeEngine(Engine* engine) {
+  ReplayCounts* counts = engine->counts;
+  counts->zswapLoads = zswapCounts.loads;
+  counts->zswapStores = zswapCounts.stores;
+  counts->zswapRejects = zswapCounts.rejects;
+  freeZswap();
+  freePrefetch();
+  freeTlb();
+  free(engine->pageTables);
+  free(engine->frameTable);
+}
+
+// Make one reference and count what it did
+void engineAccess(void* context, int slot, uint64_t address, bool isRead) {
+  Engine* engine = (Engine*)context;
+  ReplayCounts* counts = engine->counts;
+  AccessResult result = accessPage(engine->frameTable, engine->pageTables, slot, address, isRead);
+  counts->accesses++;
+  if (!isRead) counts->writes++;
+  if (result.fault) counts->faults++;
+  if (result.evicted) counts->evictions++;
+  if (result.evictedDirty) counts->dirtyEvictions++;
+  if (result.tlbHit) counts->tlbHits++;
+  if (!result.fault) {
+    if (prefetchEnabled() && prefetchUsed(result.frame)) counts->prefetchHits++;
+    return;
+  }
+  // A copy on write reads nothing in; only the page it displaced has to go somewhere
+  if (result.copied) {
+    counts->copies++;
+    counts->diskWrites += zswapEvicted(&result);
+    return;
+  }
+
+  // As in oss: a page in the compressed pool comes back from there, and the page it
+  // displaced takes its place
+  long long pageNumber = address >> engine->pageTables->pageShift;
+  bool poolDirty = false;
+  bool fromPool = zswapEnabled() && zswapLoad(slot, pageNumber, &poolDirty);
+  if (fromPool && poolDirty) setFrameBit(engine->frameTable->dirty, result.frame);
+  counts->diskWrites += zswapEvicted(&result);
+
+  if (prefetchEnabled() && !fromPool) {
+    PrefetchResult prefetch = prefetchAfterFault(engine->frameTable, engine->pageTables, slot, pageNumber,
+      result.frame);
+    counts->prefetched += prefetch.pages;
+    counts->prefetchWasted += prefetch.wasted;
+    counts->evictions += prefetch.evictions;
+    counts->dirtyEvictions += prefetch.dirtyEvictions;
+    counts->diskWrites += prefetch.diskWrites;
+  }
+}
+
+void engineExit(void* context, int slot) {
+  Engine* engine = (Engine*)context;
+  removeProcessPages(engine->frameTable, engine->pageTables, slot);
+  clearSharedCopies(engine->pageTables, slot);
+  if (prefetchEnabled()) prefetchProcessRemoved(slot);
+  if (zswapEnabled()) zswapProcessRemoved(slot);
+  engine->counts->exits++;
+}
+
+double secondsSince(const struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Feed every record of an open trace to a sink, checking it fits a system shaped by
+// config
+bool feedTrace(const TraceReader* reader, const PagingConfig* config, const ReferenceSink* sink) {
+  size_t i;
+  for (i = 0; i < reader->recordCount; i++) {
+    const TraceRecord* record = &(reader->records[i]);
+    if (record->slot >= config->processCount) {
+      fprintf(stderr, "Record %zu has invalid process slot %d\n", i, record->slot);
+      return false;
+    }
+    if (record->type == TRACE_ACCESS && record->address >> config->addressBits != 0) {
+      fprintf(stderr, "Record %zu has invalid address %llu\n", i, (unsigned long long)record->address);
+      return false;
+    }
+
+    if (record->type == TRACE_EXIT) {
+      sink->exit(sink->context, record->slot);
+    } else {
+      sink->access(sink->context, record->slot, record->address, record->isRead);
+    }
+  }
+  return true;
+}
+
+// Feed references references of a synthetic workload to a sink. Every process slot is
+// kept busy: each reference comes from a random slot, and a process that terminates, on
+// the same schedule user_proc uses, is replaced straight away by the next one. Process n
+// of the run is seeded with workloadSeed(seed, n), as oss seeds the processes it launches.
+bool feedWorkload(const PagingConfig* config, const WorkloadConfig* workloadConfig, uint64_t seed,
+  unsigned long long references, const ReferenceSink* sink) {
+  Workload* workloads = calloc(config->processCount, sizeof(Workload));
+  int* untilCheck = malloc(sizeof(int) * config->processCount);
+  if (workloads == NULL || untilCheck == NULL) {
+    perror("malloc");
+    return false;
+  }
+
+  // The scheduler draws from a workload of its own so it doesn't disturb the processes'
+  Workload scheduler;
+  int launched = 0;
+  int slot;
+  bool ok = initWorkload(&scheduler, workloadConfig, config, workloadSeed(seed, -1));
+  for (slot = 0; slot < config->processCount && ok; slot++) {
+    ok = initWorkload(&workloads[slot], workloadConfig, config, workloadSeed(seed, launched++));
+    untilCheck[slot] = workloadRandom(&workloads[slot]) % 201 + 900;
+  }
+
+  unsigned long long n;
+  for (n = 0; n < references && ok; n++) {
+    slot = (int)(workloadRandom(&scheduler) % config->processCount);
+    Workload* workload = &workloads[slot];
+
+    // Every 900 to 1100 references the process has an even chance of terminating
+    if (untilCheck[slot] == 0) {
+      if (workloadRandom(workload) % 2) {
+        sink->exit(sink->context, slot);
+        freeWorkload(workload);
+        ok = initWorkload(workload, workloadConfig, config, workloadSeed(seed, launched++));
+      }
+      untilCheck[slot] = workloadRandom(workload) % 201 + 900;
+    }
+    untilCheck[slot]--;
+
+    uint64_t address;
+    bool isRead;
+    nextReference(workload, &address, &isRead);
+    sink->access(sink->context, slot, address, isRead);
+  }
+
+  for (slot = 0; slot < config->processCount; slot++) {
+    freeWorkload(&workloads[slot]);
+  }
+  freeWorkload(&scheduler);
+  free(workloads);
+  free(untilCheck);
+  return ok;
+}
+
+// Replay an open trace on a system shaped by config, which must match the trace's
+// except for the frame count and huge pages
+bool runTrace(const TraceReader* reader, const PagingConfig* config, ReplayCounts* counts) {
+  if (replacementPolicy == &optPolicy) {
+    // Read-ahead brings in pages no access asked for, which the index has no place for
+    if (prefetchConfig.window > 0) {
+      fprintf(stderr, "The opt policy can't replay with read-ahead\n");
+      return false;
+    }
+    if (!loadOptIndex(reader, config)) return false;
+  }
+  Engine engine;
+  if (!openEngine(&engine, config, counts)) return false;
+  ReferenceSink sink = { engineAccess, engineExit, &engine };
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  bool ok = feedTrace(reader, config, &sink);
+  counts->seconds = secondsSince(&start);
+
+  closeEngine(&engine);
+  freeOptIndex();
+  return ok;
+}
+
+// Run references references of a synthetic workload through the engine
+bool runWorkload(const PagingConfig* config, const WorkloadConfig* workloadConfig, uint64_t seed,
+  unsigned long long references, ReplayCounts* counts) {
+  if (replacementPolicy == &optPolicy) {
+    fprintf(stderr, "The opt policy needs a trace to replay\n");
+    return false;
+  }
+  Engine engine;
+  if (!openEngine(&engine, config, counts)) return false;
+  ReferenceSink sink = { engineAccess, engineExit, &engine };
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  bool ok = feedWorkload(config, workloadConfig, seed, references, &sink);
+  counts->seconds = secondsSince(&start);
+
+  closeEngine(&engine);
+  return ok;
+}
+
+// Replay a recorded trace and print what happened. The system is sized as it was when
+// the trace was recorded, except that a frameCount other than 0 replaces the recorded
+// one and hugePages can turn huge pages on. Returns the process exit status.
+int replayTrace(const char* path, int frameCount, bool hugePages) {
+  TraceReader reader;
+  if (!openTraceReader(&reader, path)) return 1;
+
+  PagingConfig config = reader.config;
+  if (frameCount > 0) config.frameCount = frameCount;
+  if (hugePages) config.hugePages = true;
+  if (!checkPagingConfig(&config) || !checkPrefetchConfig(&prefetchConfig, &config) ||
+    !checkZswapConfig(&zswapConfig)) {
+    return 1;
+  }
+
+  ReplayCounts counts;
+  if (!runTrace(&reader, &config, &counts)) return 1;
+  unsigned long long accesses = counts.accesses;
+
+  printf("Replayed %s with the %s policy\n", path, replacementPolicy->name);
+  printf("  system:          %d processes, %d pages of %d bytes each in %d-bit address spaces, %d frames%s\n",
+    config.processCount, config.pagesPerProcess, config.pageSize, config.addressBits, config.frameCount,
+    config.hugePages ? ", huge pages" : "");
+  printf("  page tables:     %zu bytes\n", pageTablesSize(&config));
+  printf("  accesses:        %llu (%llu reads, %llu writes)\n", accesses, accesses - counts.writes, counts.writes);
+  printf("  process exits:   %llu\n", counts.exits);
+  printf("  page faults:     %llu (%.2f%%)\n", counts.faults, accesses ? 100.0 * counts.faults / accesses : 0.0);
+  if (config.sharedPages > 0) {
+    printf("  shared pages:    %d per process, %llu copied on write\n", config.sharedPages, counts.copies);
+  }
+  printf("  evictions:       %llu\n", counts.evictions);
+  printf("  dirty evictions: %llu\n", counts.dirtyEvictions);
+  if (zswapConfig.frames > 0) {
+    // Where each reference was served from: a frame, the compressed pool or the disk. A
+    // copy on write is served from a frame.
+    unsigned long long hits = accesses - counts.faults + counts.copies;
+    printf("  tiers:           %.2f%% frames, %.2f%% compressed pool, %.2f%% disk\n",
+      accesses ? 100.0 * hits / accesses : 0.0, accesses ? 100.0 * counts.zswapLoads / accesses : 0.0,
+      accesses ? 100.0 * (counts.faults - counts.copies - counts.zswapLoads) / accesses : 0.0);
+    printf("  compressed pool: %d frames, %llu pages stored, %llu too incompressible, %.2f%% of faults served\n",
+      zswapConfig.frames, counts.zswapStores, counts.zswapRejects,
+      counts.faults ? 100.0 * counts.zswapLoads / counts.faults : 0.0);
+    printf("  disk writes:     %llu\n", counts.diskWrites);
+  }
+  if (prefetchConfig.window > 0) {
+    printf("  read-ahead:      %llu pages, %llu used (%.2f%%), %llu evicted unused\n", counts.prefetched,
+      counts.prefetchHits, counts.prefetched ? 100.0 * counts.prefetchHits / counts.prefetched : 0.0,
+      counts.prefetchWasted);
+  }
+  if (tlbConfig.entries > 0) {
+    printf("  tlb:             %d entries, %d-way, %s\n", tlbConfig.entries, tlbConfig.ways,
+      tlbReplacementName(tlbConfig.replacement));
+    printf("  tlb hits:        %llu (%.2f%%)\n", counts.tlbHits, accesses ? 100.0 * counts.tlbHits / accesses : 0.0);
+  }
+  // Faults aren't charged here; they are dominated by the time to read the page in
+  printf("  translation:     %.3f ms simulated\n", translationNanos(&counts) / 1e6);
+  printf("  replay time:     %.3f s (%.0f records/s)\n", counts.seconds,
+    counts.seconds > 0 ? reader.recordCount / counts.seconds : 0.0);
+
+  closeTraceReader(&reader);
+  return 0;
+}
+
+// Simulated time spent translating addresses that didn't fault
+unsigned long long translationNanos(const ReplayCounts* counts) {
+  return counts->tlbHits * TLB_HIT_NANOS + (counts->accesses - counts->faults - counts->tlbHits) * PAGE_WALK_NANOS;
+}
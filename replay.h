@@ -0,0 +1,50 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "structs.h"
+#include "trace.h"
+#include "workload.h"
+
+// What an engine run did
+typedef struct {
+  unsigned long long accesses;
+  unsigned long long writes;
+  unsigned long long faults;
+  unsigned long long evictions;
+  unsigned long long dirtyEvictions;
+  unsigned long long tlbHits;
+  unsigned long long exits;
+  unsigned long long prefetched;     // pages read ahead of faults
+  unsigned long long prefetchHits;   // pages read ahead that were then used
+  unsigned long long prefetchWasted; // pages read ahead that were evicted unused
+  unsigned long long zswapLoads;     // faults served from the compressed pool
+  unsigned long long zswapStores;    // evicted pages compressed into it
+  unsigned long long zswapRejects;   // evicted pages too incompressible to keep
+  unsigned long long diskWrites;     // dirty pages written to disk, from frames or the pool
+  unsigned long long copies;         // faults that copied a shared page a process wrote to
+  double seconds; // wall time of the run
+} ReplayCounts;
+
+// Where a stream of references goes: access is called for every reference, exit when
+// the process in a slot terminates
+typedef struct {
+  void (*access)(void* context, int slot, uint64_t address, bool isRead);
+  void (*exit)(void* context, int slot);
+  void* context;
+} ReferenceSink;
+
+bool feedTrace(const TraceReader* reader, const PagingConfig* config, const ReferenceSink* sink);
+bool feedWorkload(const PagingConfig* config, const WorkloadConfig* workloadConfig, uint64_t seed,
+  unsigned long long references, const ReferenceSink* sink);
+
+bool runTrace(const TraceReader* reader, const PagingConfig* config, ReplayCounts* counts);
+bool runWorkload(const PagingConfig* config, const WorkloadConfig* workloadConfig, uint64_t seed,
+  unsigned long long references, ReplayCounts* counts);
+unsigned long long translationNanos(const ReplayCounts* counts);
+
+int replayTrace(const char* path, int frameCount, bool hugePages);
+
+#endif /* REPLAY_H */
@@ -8,9 +8,9 @@
 #include <sys/shm.h>
 #include <stdbool.h>
 
-#define IPC_RESULT_ERROR (-1)
+#include "shared_memory.h"
 
-int get_shared_block(char* filename, int size) {
+int get_shared_block(char* filename, size_t size) {
   key_t key;
 
   // Request a key
@@ -24,7 +24,7 @@ int get_shared_block(char* filename, int size) {
   return shmget(key, size, 0644 | IPC_CREAT);
 }
 
-void* attach_memory_block(char* filename, int size) {
+void* attach_memory_block(char* filename, size_t size) {
   int shared_block_id = get_shared_block(filename, size);
   void* result;
 
@@ -41,6 +41,26 @@ void* attach_memory_block(char* filename, int size) {
   return result;
 }
 
+// Attach a block only if some other program has already created it
+void* find_memory_block(char* filename, size_t size) {
+  key_t key = ftok(filename, 0);
+  if (key == IPC_RESULT_ERROR) {
+    return NULL;
+  }
+
+  int shared_block_id = shmget(key, size, 0644);
+  if (shared_block_id == IPC_RESULT_ERROR) {
+    return NULL;
+  }
+
+  void* result = shmat(shared_block_id, NULL, 0);
+  if (result == (int*)IPC_RESULT_ERROR) {
+    return NULL;
+  }
+
+  return result;
+}
+
 bool detach_memory_block(void* block) {
   return (shmdt(block) != IPC_RESULT_ERROR);
 }
@@ -2,12 +2,14 @@
 #define SHARED_MEMORY_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #define IPC_RESULT_ERROR (-1)
 
 // Function declarations
-int get_shared_block(char* filename, int size);
-void* attach_memory_block(char* filename, int size);
+int get_shared_block(char* filename, size_t size);
+void* attach_memory_block(char* filename, size_t size);
+void* find_memory_block(char* filename, size_t size);
 bool detach_memory_block(void* block);
 bool destroy_memory_block(char* filename);
 
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "shared_memory.h"
+#include "stats.h"
+
+// Bytes needed for a statistics block with slotCount process slots
+size_t statsBlockSize(int slotCount) {
+  return sizeof(StatsBlock) + sizeof(SlotStats) * (size_t)slotCount;
+}
+
+// Attach the statistics segment, creating it if needed
+StatsBlock* attachStats(int slotCount) {
+  return (StatsBlock*)attach_memory_block("stats.c", statsBlockSize(slotCount));
+}
+
+// Attach the statistics segment oss created, or return NULL if it doesn't exist yet.
+// A reader that doesn't know the slot count can pass 0 to see just the header.
+StatsBlock* findStats(int slotCount) {
+  return (StatsBlock*)find_memory_block("stats.c", statsBlockSize(slotCount));
+}
+
+// Zero every counter and mark the block as belonging to a running oss
+void initializeStats(StatsBlock* stats, int slotCount) {
+  memset(stats, 0, statsBlockSize(slotCount));
+  stats->version = STATS_VERSION;
+  stats->slotCount = slotCount;
+  stats->running = 1;
+  __atomic_store_n(&stats->magic, STATS_MAGIC, __ATOMIC_RELEASE);
+}
+
+// Tell readers oss has exited and remove the segment once everyone has detached. The
+// block stays mapped here, so threads still counting into it are safe.
+void removeStats(StatsBlock* stats) {
+  __atomic_store_n(&stats->running, 0, __ATOMIC_RELEASE);
+  destroy_memory_block("stats.c");
+}
+
+void detachStats(StatsBlock* stats, bool destroy) {
+  if (stats == NULL) return;
+  if (destroy) removeStats(stats);
+  detach_memory_block((void*)stats);
+}
+
+// Set once more than one thread counts references into the system-wide totals
+bool statsShared;
+
+void shareStats() {
+  statsShared = true;
+}
+
+// Add one to a counter, with a locked add if other threads may be adding to it too
+void statsIncrement(uint64_t* counter, bool shared) {
+  if (shared) {
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+  } else {
+    statsAdd(counter, 1);
+  }
+}
+
+// Add one reference to a set of counters
+void statsCount(SlotStats* counters, bool isRead, const AccessResult* result, bool shared) {
+  statsIncrement(&counters->accesses, shared);
+  statsIncrement(isRead ? &counters->reads : &counters->writes, shared);
+  if (result->tlbHit) statsIncrement(&counters->tlbHits, shared);
+  if (!result->fault) {
+    statsIncrement(&counters->hits, shared);
+    return;
+  }
+  statsIncrement(&counters->faults, shared);
+  if (result->evicted) statsIncrement(&counters->evictions, shared);
+  if (result->evictedDirty) statsIncrement(&counters->dirtyEvictions, shared);
+  if (result->copied) statsIncrement(&counters->copies, shared);
+}
+
+// Count a memory reference served for the process in slot
+void statsAccess(StatsBlock* stats, int slot, bool isRead, const AccessResult* result, sclock_t* clock) {
+  unsigned long long now = clock_to_nano(*clock);
+  __atomic_store_n(&stats->simTime, now, __ATOMIC_RELAXED);
+
+  // A slot is only ever served by one thread, but the totals may be shared
+  statsCount(&stats->total, isRead, result, statsShared);
+  statsCount(&stats->slots[slot], isRead, result, false);
+  if (result->fault) {
+    __atomic_store_n(&stats->slots[slot].blockedSince, now, __ATOMIC_RELAXED);
+  }
+}
+
+// A faulting process has been unblocked: record how long the fault took to serve
+void statsFaultDone(StatsBlock* stats, int slot, sclock_t* clock) {
+  SlotStats* counters = &stats->slots[slot];
+  unsigned long long now = clock_to_nano(*clock);
+  unsigned long long latency = now - statsRead(&counters->blockedSince);
+
+  statsAdd(&counters->blockedNanos, latency);
+  statsAdd(&stats->total.blockedNanos, latency);
+  __atomic_store_n(&counters->blockedSince, 0, __ATOMIC_RELAXED);
+
+  int bucket = 0;
+  while (bucket < STATS_LATENCY_BUCKETS - 1 && (1ULL << (bucket + 1)) <= latency) {
+    bucket++;
+  }
+  statsAdd(&stats->faultLatency[bucket], 1);
+}
+
+// A process was launched into slot; its counters start from zero
+void statsLaunch(StatsBlock* stats, int slot, int pid) {
+  SlotStats* counters = &stats->slots[slot];
+  memset(counters, 0, sizeof(SlotStats));
+  __atomic_store_n(&counters->pid, pid, __ATOMIC_RELAXED);
+  statsAdd(&stats->launches, 1);
+}
+
+void statsTerminate(StatsBlock* stats, int slot) {
+  __atomic_store_n(&stats->slots[slot].pid, 0, __ATOMIC_RELAXED);
+  statsAdd(&stats->terminations, 1);
+}
+
+// The page-out daemon freed clean frames and queued dirty pages in some number of writes
+void statsPageOut(StatsBlock* stats, int freed, int pages, int writes) {
+  statsAdd(&stats->pageOutFreed, freed);
+  statsAdd(&stats->writeBackPages, pages);
+  statsAdd(&stats->writeBacks, writes);
+}
+
+void statsPrefetch(StatsBlock* stats, int pages, int hits, int wasted) {
+  statsAdd(&stats->prefetched, pages);
+  statsAdd(&stats->prefetchHits, hits);
+  statsAdd(&stats->prefetchWasted, wasted);
+}
+
+// Publish the compressed pool's running totals
+void statsZswap(StatsBlock* stats, const ZswapCounts* counts, size_t bytes) {
+  __atomic_store_n(&stats->zswapLoads, counts->loads, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->zswapStores, counts->stores, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->zswapRejects, counts->rejects, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->zswapWriteBacks, counts->writeBacks, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->zswapBytes, bytes, __ATOMIC_RELAXED);
+}
+
+// Load control swapped the process in a slot out, or let it run again
+void statsSuspend(StatsBlock* stats, int slot, bool suspended) {
+  __atomic_store_n(&stats->slots[slot].suspended, suspended, __ATOMIC_RELAXED);
+  statsAdd(suspended ? &stats->suspensions : &stats->resumes, 1);
+}
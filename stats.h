@@ -0,0 +1,87 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "structs.h"
+#include "zswap.h"
+
+#define STATS_MAGIC 0x5441545353534fULL // "OSSSTAT"
+#define STATS_VERSION 8
+// Fault service times are bucketed by powers of two nanoseconds
+#define STATS_LATENCY_BUCKETS 40
+
+// Counters for one process slot, or for the whole system. Each block sits on its own
+// cache line so a monitor reading it never shares a line with another slot's writes.
+typedef struct {
+  uint64_t accesses;
+  uint64_t reads;
+  uint64_t writes;
+  uint64_t hits;
+  uint64_t tlbHits;
+  uint64_t faults;
+  uint64_t evictions;
+  uint64_t dirtyEvictions;
+  uint64_t copies;       // shared pages copied on write
+  uint64_t blockedNanos;
+  uint64_t blockedSince; // simulated time the slot's current fault started, 0 if not blocked
+  uint64_t suspended;    // 1 while load control has the process swapped out
+  int64_t pid;           // process in the slot, 0 if free
+} __attribute__((aligned(64))) SlotStats;
+
+// Statistics segment shared between oss, which is the only writer, and ossstat
+typedef struct {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint64_t running; // cleared when oss exits
+  uint64_t simTime; // simulated clock in nanoseconds
+  uint64_t launches;
+  uint64_t terminations;
+  uint64_t pageOutFreed;   // clean frames the page-out daemon returned to the free pool
+  uint64_t writeBackPages; // dirty pages the daemon queued for writing
+  uint64_t writeBacks;     // disk writes those pages were grouped into
+  uint64_t prefetched;     // pages read ahead of faults
+  uint64_t prefetchHits;   // pages read ahead that were then used
+  uint64_t prefetchWasted; // pages read ahead that were evicted unused
+  uint64_t zswapLoads;      // faults served from the compressed pool
+  uint64_t zswapStores;     // evicted pages compressed into it
+  uint64_t zswapRejects;    // evicted pages too incompressible to keep
+  uint64_t zswapWriteBacks; // dirty pages pushed out of the pool to disk
+  uint64_t zswapBytes;      // compressed bytes in the pool
+  uint64_t suspensions;     // processes load control swapped out
+  uint64_t resumes;         // processes it let run again
+  SlotStats total;
+  uint64_t faultLatency[STATS_LATENCY_BUCKETS] __attribute__((aligned(64)));
+  SlotStats slots[]; // slotCount entries, one per process slot
+} StatsBlock;
+
+size_t statsBlockSize(int slotCount);
+StatsBlock* attachStats(int slotCount);
+StatsBlock* findStats(int slotCount);
+void initializeStats(StatsBlock* stats, int slotCount);
+void removeStats(StatsBlock* stats);
+void detachStats(StatsBlock* stats, bool destroy);
+void shareStats();
+
+void statsAccess(StatsBlock* stats, int slot, bool isRead, const AccessResult* result, sclock_t* clock);
+void statsFaultDone(StatsBlock* stats, int slot, sclock_t* clock);
+void statsLaunch(StatsBlock* stats, int slot, int pid);
+void statsTerminate(StatsBlock* stats, int slot);
+void statsPageOut(StatsBlock* stats, int freed, int pages, int writes);
+void statsPrefetch(StatsBlock* stats, int pages, int hits, int wasted);
+void statsZswap(StatsBlock* stats, const ZswapCounts* counts, size_t bytes);
+void statsSuspend(StatsBlock* stats, int slot, bool suspended);
+
+// Add to a counter that only oss writes. The relaxed atomic load and store keep readers
+// from seeing a torn value without paying for a locked read-modify-write.
+static inline void statsAdd(uint64_t* counter, uint64_t amount) {
+  __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t statsRead(const uint64_t* counter) {
+  return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+#endif /* STATS_H */
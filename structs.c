@@ -1,5 +1,9 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
 #include "structs.h"
+#include "policy.h"
+#include "tlb.h"
 
 // Print time from clock
 void print_clock(sclock_t* clock) {
@@ -20,102 +24,738 @@ unsigned int time_between_nano(sclock_t clock1, sclock_t clock2) {
   return nanoseconds1 - nanoseconds2;
 }
 
-// Initialize page tables
-void initializePageTables(PageTable* pageTables) {
-  int i, j;
-  for (i = 0; i < 18; i++) {
-    for (j = 0; j < 32; j++) {
-      pageTables[i].pages[j].frame = -1;
+// Fill in the sizes oss has always used
+void defaultPagingConfig(PagingConfig* config) {
+  config->processCount = DEFAULT_PROCESS_COUNT;
+  config->pagesPerProcess = DEFAULT_PAGES_PER_PROCESS;
+  config->frameCount = DEFAULT_FRAME_COUNT;
+  config->pageSize = DEFAULT_PAGE_SIZE;
+  config->addressBits = 0;
+  config->hugePages = false;
+  config->sharedPages = 0;
+}
+
+// Width of the smallest address space that holds every page a process uses
+int denseAddressBits(const PagingConfig* config) {
+  int bits = 0;
+  while ((1LL << bits) < config->pagesPerProcess) {
+    bits++;
+  }
+  return __builtin_ctz(config->pageSize) + bits;
+}
+
+// Levels of page table nodes needed for a configuration, and the page number bits each
+// level indexes
+void pageTableShape(const PagingConfig* config, int* levels, int* levelBits) {
+  int pageBits = config->addressBits - __builtin_ctz(config->pageSize);
+  *levelBits = pageBits < PAGE_LEVEL_BITS ? pageBits : PAGE_LEVEL_BITS;
+  *levels = pageBits <= *levelBits ? 1 : (pageBits + *levelBits - 1) / *levelBits;
+}
+
+// Check that a configuration is usable, printing the problem if it isn't
+bool checkPagingConfig(const PagingConfig* config) {
+  if (config->processCount < 1 || config->pagesPerProcess < 1 || config->frameCount < 1) {
+    fprintf(stderr, "Process, page and frame counts must be at least 1\n");
+    return false;
+  }
+  if (config->pageSize < 1 || (config->pageSize & (config->pageSize - 1)) != 0) {
+    fprintf(stderr, "Page size %d is not a power of two\n", config->pageSize);
+    return false;
+  }
+  if (config->addressBits > MAX_ADDRESS_BITS || config->addressBits < denseAddressBits(config)) {
+    fprintf(stderr, "A %d-bit address space can't hold %d pages of %d bytes (the most is %d bits)\n",
+      config->addressBits, config->pagesPerProcess, config->pageSize, MAX_ADDRESS_BITS);
+    return false;
+  }
+
+  int levels, levelBits;
+  pageTableShape(config, &levels, &levelBits);
+  if (config->hugePages && (levels < 2 || (1 << levelBits) > config->frameCount)) {
+    fprintf(stderr, "Huge pages need a page table of at least two levels and %d frames\n", 1 << PAGE_LEVEL_BITS);
+    return false;
+  }
+  if (config->sharedPages < 0 || config->sharedPages > config->pagesPerProcess) {
+    fprintf(stderr, "Between 0 and %d of each process's pages can be shared\n", config->pagesPerProcess);
+    return false;
+  }
+  // A huge page would map shared and private pages onto one run of frames
+  if (config->sharedPages > 0 && config->hugePages) {
+    fprintf(stderr, "Shared pages can't be used with huge pages\n");
+    return false;
+  }
+  return true;
+}
+
+// Pages from the start of one cluster of a process's pages to the start of the next
+long long clusterStride(const PagingConfig* config) {
+  long long virtualPages = 1LL << (config->addressBits - __builtin_ctz(config->pageSize));
+  long long clusters = (config->pagesPerProcess + PAGE_CLUSTER - 1) / PAGE_CLUSTER;
+  return virtualPages / clusters & ~(long long)(PAGE_CLUSTER - 1);
+}
+
+// Virtual page number of the n-th page a process uses. The pages come in clusters of
+// PAGE_CLUSTER consecutive pages spread evenly over the address space, so a wide address
+// space is used sparsely while each cluster stays within one leaf node.
+long long processPageNumber(const PagingConfig* config, int n) {
+  return n / PAGE_CLUSTER * clusterStride(config) + n % PAGE_CLUSTER;
+}
+
+// Nodes in the page table pool: a root per slot, and a path below it for every cluster
+// of pages each process uses
+int pageTableNodeCount(const PagingConfig* config, int levels) {
+  int clusters = (config->pagesPerProcess + PAGE_CLUSTER - 1) / PAGE_CLUSTER;
+  return config->processCount * (1 + (levels - 1) * clusters);
+}
+
+// Bytes needed for the page tables of every process slot and the shared pages
+size_t pageTablesSize(const PagingConfig* config) {
+  int levels, levelBits;
+  pageTableShape(config, &levels, &levelBits);
+  return sizeof(PageTable) + (sizeof(Page) << levelBits) * (size_t)pageTableNodeCount(config, levels) +
+    (2 * sizeof(int) + (sizeof(SharedMapper) + sizeof(bool)) * config->processCount) * (size_t)config->sharedPages;
+}
+
+// Number of 64-bit words in a bitmap with one bit per frame
+int frameWordCount(int frameCount) {
+  return (frameCount + FRAME_WORD_BITS - 1) / FRAME_WORD_BITS;
+}
+
+// Bytes needed for a frame table with its bitmaps, frames and owners
+size_t frameTableSize(int frameCount) {
+  return sizeof(FrameTable) + 3 * sizeof(uint64_t) * frameWordCount(frameCount) +
+    (sizeof(Frame) + sizeof(FrameOwner)) * (size_t)frameCount;
+}
+
+// Mask of the bits below bit n of a word
+uint64_t bitsBelow(int n) {
+  return n >= FRAME_WORD_BITS ? ~0ULL : (1ULL << n) - 1;
+}
+
+// Entries of a page table node
+Page* nodeEntries(PageTable* pageTables, int node) {
+  return &(pageTables->nodes[(size_t)node << pageTables->levelBits]);
+}
+
+// Frame holding each shared page, -1 if it isn't resident
+int* sharedFrames(PageTable* pageTables) {
+  return (int*)&(pageTables->nodes[(size_t)pageTables->nodeCount << pageTables->levelBits]);
+}
+
+// First slot in the list of slots mapping each shared page's frame, -1 if none does
+int* sharedMapperHeads(PageTable* pageTables) {
+  return sharedFrames(pageTables) + pageTables->config.sharedPages;
+}
+
+// A slot's links in the mapper list of each shared page
+SharedMapper* sharedMappers(PageTable* pageTables, int pageTableIndex) {
+  int count = pageTables->config.sharedPages;
+  return (SharedMapper*)(sharedMapperHeads(pageTables) + count) + (size_t)pageTableIndex * count;
+}
+
+// Whether the process in a slot has written to each shared page, making it its own
+bool* sharedCopies(PageTable* pageTables, int pageTableIndex) {
+  int count = pageTables->config.sharedPages;
+  return (bool*)sharedMappers(pageTables, pageTables->config.processCount) + (size_t)pageTableIndex * count;
+}
+
+// Empty every entry of a node
+void clearNode(PageTable* pageTables, int node) {
+  Page* entries = nodeEntries(pageTables, node);
+  int i;
+  for (i = 0; i < 1 << pageTables->levelBits; i++) {
+    entries[i].frame = -1;
+    entries[i].next = -1;
+  }
+}
+
+// Initialize page tables: an empty root for every slot, and every other node in the pool
+void initializePageTables(PageTable* pageTables, const PagingConfig* config) {
+  pageTables->config = *config;
+  pageTables->pageShift = __builtin_ctz(config->pageSize);
+  pageTableShape(config, &pageTables->levels, &pageTables->levelBits);
+  pageTables->nodeCount = pageTableNodeCount(config, pageTables->levels);
+  pageTables->lock = 0;
+
+  int i;
+  for (i = 0; i < pageTables->nodeCount; i++) {
+    clearNode(pageTables, i);
+  }
+  pageTables->freeNode = -1;
+  for (i = pageTables->nodeCount - 1; i >= config->processCount; i--) {
+    nodeEntries(pageTables, i)->next = pageTables->freeNode;
+    pageTables->freeNode = i;
+  }
+
+  for (i = 0; i < config->sharedPages; i++) {
+    sharedFrames(pageTables)[i] = -1;
+    sharedMapperHeads(pageTables)[i] = -1;
+  }
+  for (i = 0; i < config->processCount; i++) {
+    clearSharedCopies(pageTables, i);
+  }
+}
+
+void lockPageTables(PageTable* pageTables) {
+  while (__atomic_exchange_n(&pageTables->lock, 1, __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+}
+
+void unlockPageTables(PageTable* pageTables) {
+  __atomic_store_n(&pageTables->lock, 0, __ATOMIC_RELEASE);
+}
+
+// Take an empty node from the pool
+int allocateNode(PageTable* pageTables) {
+  lockPageTables(pageTables);
+  int node = pageTables->freeNode;
+  if (node != -1) pageTables->freeNode = nodeEntries(pageTables, node)->next;
+  unlockPageTables(pageTables);
+
+  if (node == -1) {
+    fprintf(stderr, "The page table pool is out of nodes\n");
+    exit(1);
+  }
+  clearNode(pageTables, node);
+  return node;
+}
+
+// Put a node and everything below it back in the pool
+void releaseNode(PageTable* pageTables, int node, int level) {
+  Page* entries = nodeEntries(pageTables, node);
+  int i;
+  if (level < pageTables->levels - 1) {
+    for (i = 0; i < 1 << pageTables->levelBits; i++) {
+      if (entries[i].next != -1) releaseNode(pageTables, entries[i].next, level + 1);
     }
   }
+
+  lockPageTables(pageTables);
+  entries->next = pageTables->freeNode;
+  pageTables->freeNode = node;
+  unlockPageTables(pageTables);
+}
+
+// Index into a node at the given level for a page; level 0 is the root
+int levelIndex(const PageTable* pageTables, long long pageNumber, int level) {
+  int shift = (pageTables->levels - 1 - level) * pageTables->levelBits;
+  return (pageNumber >> shift) & ((1 << pageTables->levelBits) - 1);
+}
+
+// Entry for a page at the given level of a slot's tree, allocating the nodes above it
+// that are missing. A huge page in the way is split into a leaf node mapping the same
+// frames one page at a time.
+Page* walkPageTable(PageTable* pageTables, int pageTableIndex, long long pageNumber, int depth) {
+  Page* entry = nodeEntries(pageTables, pageTableIndex) + levelIndex(pageTables, pageNumber, 0);
+  int level;
+  for (level = 1; level <= depth; level++) {
+    if (entry->next == -1) {
+      int node = allocateNode(pageTables);
+      if (entry->frame != -1) {
+        Page* leaf = nodeEntries(pageTables, node);
+        int i;
+        for (i = 0; i < 1 << pageTables->levelBits; i++) {
+          leaf[i].frame = entry->frame + i;
+        }
+        entry->frame = -1;
+      }
+      entry->next = node;
+    }
+    entry = nodeEntries(pageTables, entry->next) + levelIndex(pageTables, pageNumber, level);
+  }
+  return entry;
 }
 
 // Initialize frame table
-void initializeFrameTable(FrameTable* frameTable) {
+void initializeFrameTable(FrameTable* frameTable, int frameCount) {
+  int wordCount = frameWordCount(frameCount);
+  frameTable->freeFrames = (uint64_t*)(frameTable + 1);
+  frameTable->referenced = frameTable->freeFrames + wordCount;
+  frameTable->dirty = frameTable->referenced + wordCount;
+  frameTable->owners = (FrameOwner*)(frameTable->dirty + wordCount);
+  frameTable->frames = (Frame*)(frameTable->owners + frameCount);
+
+  // Every frame starts in the free pool; bits past the last frame are never set
   int i;
-  for (i = 0; i < 256; i++) {
-    frameTable->frames[i].occupied = false;
+  for (i = 0; i < wordCount; i++) {
+    frameTable->freeFrames[i] = bitsBelow(frameCount - i * FRAME_WORD_BITS);
+    frameTable->referenced[i] = 0;
+    frameTable->dirty[i] = 0;
+  }
+  for (i = 0; i < frameCount; i++) {
     frameTable->frames[i].reference_byte = 0;
-    frameTable->frames[i].dirty_bit = 0;
+    frameTable->frames[i].sharedPage = -1;
+    frameTable->frames[i].mapCount = 0;
+    frameTable->owners[i].process = -1;
+    frameTable->owners[i].page = -1;
   }
+  frameTable->frameCount = frameCount;
+  frameTable->wordCount = wordCount;
+  frameTable->freeCount = frameCount;
+  frameTable->freeHint = 0;
   frameTable->headIndex = 0;
+  replacementPolicy->init(frameTable);
 }
 
-// Print frame table
-void printFrameTable(const FrameTable* frameTable, sclock_t* clock) {
-  printf("Current memory layout at time %u:%u is:\n", clock->seconds, clock->nanoseconds);
-  printf("              Occupied  Dirty Bit  Reference Bit\n");
-  printf("----------------------------------------------\n");
+// Leaf page table entry for one page of the process in a slot, allocating the nodes
+// leading to it if they are missing
+Page* pageEntry(PageTable* pageTables, int pageTableIndex, long long pageNumber) {
+  return walkPageTable(pageTables, pageTableIndex, pageNumber, pageTables->levels - 1);
+}
 
-  for (int i = 0; i < 256; i++) {
-    const Frame* frame = &(frameTable->frames[i]);
-    if (frame->occupied) {
-      printf("%-13d %-9s %-9d %-13d\n", i, "Yes", frame->dirty_bit, frame->reference_byte);
+// Leaf page table entry for a page, or NULL if no leaf node covers it yet. Doesn't
+// allocate, so it can be used without knowing whether the page was ever mapped.
+Page* findPageEntry(PageTable* pageTables, int pageTableIndex, long long pageNumber) {
+  Page* entry = nodeEntries(pageTables, pageTableIndex) + levelIndex(pageTables, pageNumber, 0);
+  int level;
+  for (level = 1; level < pageTables->levels; level++) {
+    if (entry->next == -1) return NULL;
+    entry = nodeEntries(pageTables, entry->next) + levelIndex(pageTables, pageNumber, level);
+  }
+  return entry;
+}
+
+// Walk a slot's page table to the frame holding a page, or -1 if it isn't resident
+int lookupPage(PageTable* pageTables, int pageTableIndex, long long pageNumber) {
+  Page* entry = nodeEntries(pageTables, pageTableIndex) + levelIndex(pageTables, pageNumber, 0);
+  int level;
+  for (level = 1; level < pageTables->levels; level++) {
+    if (entry->next == -1) {
+      // A huge page maps the range below this entry onto consecutive frames
+      if (entry->frame == -1) return -1;
+      return entry->frame + (int)(pageNumber & ((1 << pageTables->levelBits) - 1));
     }
+    entry = nodeEntries(pageTables, entry->next) + levelIndex(pageTables, pageNumber, level);
+  }
+  return entry->frame;
+}
+
+// Return the nodes of a terminated process's page table to the pool and empty its root
+void freeProcessPageTable(PageTable* pageTables, int pageTableIndex) {
+  Page* root = nodeEntries(pageTables, pageTableIndex);
+  int i;
+  for (i = 0; i < 1 << pageTables->levelBits; i++) {
+    if (pageTables->levels > 1 && root[i].next != -1) releaseNode(pageTables, root[i].next, 1);
+    root[i].frame = -1;
+    root[i].next = -1;
+  }
+}
+
+// Index of a page among the shared pages, or -1 if it is private. The shared pages are
+// the first sharedPages pages every process uses, at the same page numbers in all of them.
+int sharedPageIndex(const PageTable* pageTables, long long pageNumber) {
+  const PagingConfig* config = &(pageTables->config);
+  if (config->sharedPages == 0) return -1;
+
+  long long stride = clusterStride(config);
+  long long offset = pageNumber % stride;
+  if (offset >= PAGE_CLUSTER) return -1;
+  long long n = pageNumber / stride * PAGE_CLUSTER + offset;
+  return n < config->sharedPages ? (int)n : -1;
+}
+
+// Index of a page among the shared pages if the process in a slot still shares it, or -1
+// if the page is private to it
+int sharedPageOf(PageTable* pageTables, int pageTableIndex, long long pageNumber) {
+  int shared = sharedPageIndex(pageTables, pageNumber);
+  if (shared == -1 || sharedCopies(pageTables, pageTableIndex)[shared]) return -1;
+  return shared;
+}
+
+// A new process in a slot shares every shared page again
+void clearSharedCopies(PageTable* pageTables, int pageTableIndex) {
+  int i;
+  for (i = 0; i < pageTables->config.sharedPages; i++) {
+    sharedCopies(pageTables, pageTableIndex)[i] = false;
   }
 }
 
+// Add a slot to the slots mapping a shared page's frame
+void addSharedMapper(PageTable* pageTables, int shared, int pageTableIndex) {
+  int* head = &(sharedMapperHeads(pageTables)[shared]);
+  SharedMapper* mapper = &(sharedMappers(pageTables, pageTableIndex)[shared]);
+  mapper->prev = -1;
+  mapper->next = *head;
+  if (*head != -1) sharedMappers(pageTables, *head)[shared].prev = pageTableIndex;
+  *head = pageTableIndex;
+}
+
+// Take a slot out of the slots mapping a shared page's frame
+void removeSharedMapper(PageTable* pageTables, int shared, int pageTableIndex) {
+  SharedMapper* mapper = &(sharedMappers(pageTables, pageTableIndex)[shared]);
+  if (mapper->prev != -1) sharedMappers(pageTables, mapper->prev)[shared].next = mapper->next;
+  else sharedMapperHeads(pageTables)[shared] = mapper->next;
+  if (mapper->next != -1) sharedMappers(pageTables, mapper->next)[shared].prev = mapper->prev;
+}
+
+// Drop a slot's mapping of a shared page's frame from the frame's mappers. The frame is
+// handed to another slot still mapping it if the slot owned it.
+void dropSharedMapper(FrameTable* frameTable, PageTable* pageTables, int pageTableIndex, int frameNumber) {
+  Frame* frame = &(frameTable->frames[frameNumber]);
+  FrameOwner* owner = &(frameTable->owners[frameNumber]);
+  removeSharedMapper(pageTables, frame->sharedPage, pageTableIndex);
+  frame->mapCount--;
+  if (owner->process == pageTableIndex) owner->process = sharedMapperHeads(pageTables)[frame->sharedPage];
+}
+
+// Take a shared page's frame out of one slot's page table. The frame stays resident for
+// the other processes mapping it.
+void unmapSharedPage(FrameTable* frameTable, PageTable* pageTables, int pageTableIndex, int frameNumber) {
+  FrameOwner* owner = &(frameTable->owners[frameNumber]);
+  findPageEntry(pageTables, pageTableIndex, owner->page)->frame = -1;
+  tlbInvalidate(pageTableIndex, owner->page);
+  dropSharedMapper(frameTable, pageTables, pageTableIndex, frameNumber);
+}
+
 // Get frame from address
-int getFrameFromAddr(int address, PageTable* pageTables, int pageTableIndex) {
-  int pageNumber = address / 1024;
-  return pageTables[pageTableIndex].pages[pageNumber].frame;
-}
-
-// Reset page at a given frame
-void resetPageAtFrame(int frameNumber, PageTable* pageTables) {
-  int i, j;
-  for (i = 0; i < 18; i++) {
-    for (j = 0; j < 32; j++) {
-      if (pageTables[i].pages[j].frame == frameNumber) {
-        pageTables[i].pages[j].frame = -1;
-        return;
+int getFrameFromAddr(uint64_t address, PageTable* pageTables, int pageTableIndex) {
+  return lookupPage(pageTables, pageTableIndex, address >> pageTables->pageShift);
+}
+
+// Reset page at a given frame, using the frame table's reverse mapping to find its owner.
+// A shared page is unmapped from every process mapping it.
+void resetPageAtFrame(FrameTable* frameTable, int frameNumber, PageTable* pageTables) {
+  FrameOwner* owner = &(frameTable->owners[frameNumber]);
+  if (owner->process == -1) return;
+
+  Frame* frame = &(frameTable->frames[frameNumber]);
+  if (frame->sharedPage != -1) {
+    while (frame->mapCount > 0) {
+      unmapSharedPage(frameTable, pageTables, owner->process, frameNumber);
+    }
+    sharedFrames(pageTables)[frame->sharedPage] = -1;
+    frame->sharedPage = -1;
+  } else {
+    pageEntry(pageTables, owner->process, owner->page)->frame = -1;
+    tlbInvalidate(owner->process, owner->page);
+  }
+  owner->process = -1;
+  owner->page = -1;
+}
+
+// Return the frames mapped below a node of a terminated process's page table to the free
+// pool, in page order
+void removeNodePages(FrameTable* frameTable, PageTable* pageTables, int pageTableIndex, int node, int level) {
+  Page* entries = nodeEntries(pageTables, node);
+  int i;
+  for (i = 0; i < 1 << pageTables->levelBits; i++) {
+    if (entries[i].next != -1) {
+      removeNodePages(frameTable, pageTables, pageTableIndex, entries[i].next, level + 1);
+      continue;
+    }
+    if (entries[i].frame == -1) continue;
+
+    // A shared page stays in memory while other processes map it
+    Frame* shared = &(frameTable->frames[entries[i].frame]);
+    if (shared->sharedPage != -1 && shared->mapCount > 1) {
+      dropSharedMapper(frameTable, pageTables, pageTableIndex, entries[i].frame);
+      entries[i].frame = -1;
+      continue;
+    }
+    if (shared->sharedPage != -1) {
+      removeSharedMapper(pageTables, shared->sharedPage, pageTableIndex);
+      sharedFrames(pageTables)[shared->sharedPage] = -1;
+    }
+
+    // Above the leaves, a mapped entry is a huge page covering a whole node of frames
+    int count = level < pageTables->levels - 1 ? 1 << pageTables->levelBits : 1;
+    int j;
+    for (j = 0; j < count; j++) {
+      int frame = entries[i].frame + j;
+      releaseFrame(frameTable, frame);
+      if (replacementPolicy->removed != NULL) {
+        replacementPolicy->removed(frameTable, frame);
       }
     }
+
+    // Update the page table to indicate the frame is no longer assigned
+    entries[i].frame = -1;
   }
 }
 
 void removeProcessPages(FrameTable* frameTable, PageTable* pageTables, int pageTableIndex) {
+  tlbFlush(pageTableIndex);
+  removeNodePages(frameTable, pageTables, pageTableIndex, pageTableIndex, 0);
+  freeProcessPageTable(pageTables, pageTableIndex);
+
+  if (replacementPolicy->processRemoved != NULL) {
+    replacementPolicy->processRemoved(pageTableIndex);
+  }
+}
+
+// Let the replacement policy know a resident page was referenced
+void recordAccess(FrameTable* frameTable, int frameNumber) {
+  if (replacementPolicy->accessed != NULL) {
+    replacementPolicy->accessed(frameTable, frameNumber);
+  }
+}
+
+// Find a frame in the free pool, or -1 if every frame is in use. Once memory fills up
+// the pool is usually empty, so the count is checked before touching the bitmap.
+int findFreeFrame(FrameTable* frameTable) {
+  if (frameTable->freeCount == 0) return -1;
+
   int i;
-  for (i = 0; i < 32; i++) {
-    int frame = pageTables[pageTableIndex].pages[i].frame;
-    if (frame != -1) {
-      // Mark the frame as unoccupied and reset its attributes
-      frameTable->frames[frame].occupied = false;
-      frameTable->frames[frame].dirty_bit = 0;
-      frameTable->frames[frame].reference_byte = 0;
-
-      // Update the page table to indicate the frame is no longer assigned
-      pageTables[pageTableIndex].pages[i].frame = -1;
+  for (i = frameTable->freeHint; i < frameTable->wordCount; i++) {
+    if (frameTable->freeFrames[i] != 0) {
+      frameTable->freeHint = i;
+      return i * FRAME_WORD_BITS + __builtin_ctzll(frameTable->freeFrames[i]);
+    }
+  }
+  return -1;
+}
+
+// Find an aligned run of count free frames, count being a power of two, or -1 if there
+// is none. Runs of a word or more are whole words of the free bitmap.
+int findFreeRun(FrameTable* frameTable, int count) {
+  if (frameTable->freeCount < count) return -1;
+
+  int word, i;
+  if (count >= FRAME_WORD_BITS) {
+    int words = count / FRAME_WORD_BITS;
+    for (word = frameTable->freeHint / words * words; word + words <= frameTable->wordCount; word += words) {
+      for (i = 0; i < words && frameTable->freeFrames[word + i] == ~0ULL; i++);
+      if (i == words) return word * FRAME_WORD_BITS;
+    }
+    return -1;
+  }
+
+  uint64_t run = bitsBelow(count);
+  for (word = frameTable->freeHint; word < frameTable->wordCount; word++) {
+    uint64_t bits = frameTable->freeFrames[word];
+    for (i = 0; i < FRAME_WORD_BITS && (bits >> i) != 0; i += count) {
+      if (((bits >> i) & run) == run) return word * FRAME_WORD_BITS + i;
     }
   }
+  return -1;
+}
+
+// Put a frame back in the free pool and reset its attributes
+void releaseFrame(FrameTable* frameTable, int frameNumber) {
+  setFrameBit(frameTable->freeFrames, frameNumber);
+  clearFrameBit(frameTable->referenced, frameNumber);
+  clearFrameBit(frameTable->dirty, frameNumber);
+  frameTable->frames[frameNumber].reference_byte = 0;
+  frameTable->frames[frameNumber].sharedPage = -1;
+  frameTable->frames[frameNumber].mapCount = 0;
+  frameTable->owners[frameNumber].process = -1;
+  frameTable->owners[frameNumber].page = -1;
+  frameTable->freeCount++;
+  if (frameNumber / FRAME_WORD_BITS < frameTable->freeHint) {
+    frameTable->freeHint = frameNumber / FRAME_WORD_BITS;
+  }
+}
+
+// Sweep a clock hand from start, a word of frames at a time, to the first frame whose
+// referenced bit is clear. Referenced frames passed on the way have their bit cleared,
+// so if every frame was referenced the hand comes back around to start.
+int sweepReferenced(FrameTable* frameTable, int start) {
+  int frame = start;
+  while (true) {
+    int word = frame / FRAME_WORD_BITS;
+    int first = frame % FRAME_WORD_BITS;
+    int last = frameTable->frameCount - word * FRAME_WORD_BITS;
+    uint64_t range = bitsBelow(last) & ~bitsBelow(first);
+
+    uint64_t unreferenced = ~frameTable->referenced[word] & range;
+    if (unreferenced != 0) {
+      int found = __builtin_ctzll(unreferenced);
+      frameTable->referenced[word] &= ~(range & bitsBelow(found));
+      return word * FRAME_WORD_BITS + found;
+    }
+
+    frameTable->referenced[word] &= ~range;
+    frame = (word + 1) * FRAME_WORD_BITS;
+    if (frame >= frameTable->frameCount) frame = 0;
+  }
 }
 
-void replacePage(FrameTable* frameTable, int address, PageTable* pageTables, int pageTableIndex) {
-  int pageNumber = address / 1024;
+// Fault in the huge page around a page if no part of it is mapped and there is an aligned
+// run of free frames for it. Every page of the huge page becomes resident.
+bool mapHugePage(FrameTable* frameTable, PageTable* pageTables, int pageTableIndex, long long pageNumber,
+  AccessResult* result) {
+  int count = 1 << pageTables->levelBits;
+  Page* entry = walkPageTable(pageTables, pageTableIndex, pageNumber, pageTables->levels - 2);
+  if (entry->next != -1 || entry->frame != -1) return false;
 
+  int first = findFreeRun(frameTable, count);
+  if (first == -1) return false;
+
+  long long firstPage = pageNumber & ~(long long)(count - 1);
   int i;
-  for (i = 0; i < 256; i++) {
-    int index = frameTable->headIndex + i % 256;
-    frameTable->headIndex = index;
-
-    // Check if the frame is not already occupied
-    if (!frameTable->frames[index].occupied) {
-      // Assign the frame to the page in the page table
-      pageTables[pageTableIndex].pages[pageNumber].frame = index;
-      frameTable->frames[index].occupied = true;
-      return;
+  for (i = 0; i < count; i++) {
+    int index = first + i;
+    clearFrameBit(frameTable->freeFrames, index);
+    clearFrameBit(frameTable->referenced, index);
+    clearFrameBit(frameTable->dirty, index);
+    frameTable->frames[index].reference_byte = 0;
+    frameTable->owners[index].process = pageTableIndex;
+    frameTable->owners[index].page = firstPage + i;
+    replacementPolicy->inserted(frameTable, index, pageTableIndex, firstPage + i);
+  }
+  frameTable->freeCount -= count;
+  entry->frame = first;
+
+  int frame = first + (int)(pageNumber - firstPage);
+  tlbInsert(pageTableIndex, pageNumber, frame);
+  if (result != NULL) {
+    result->frame = frame;
+    result->fault = true;
+    result->evicted = false;
+    result->evictedDirty = false;
+    result->tlbHit = false;
+    result->copied = false;
+    result->evictedProcess = -1;
+    result->evictedPage = -1;
+  }
+  return true;
+}
+
+// Map a shared page that another process already has in memory into a slot's page
+// table. Nothing has to be read, so this isn't a fault.
+void mapSharedPage(FrameTable* frameTable, PageTable* pageTables, int pageTableIndex, long long pageNumber,
+  int frameNumber, AccessResult* result) {
+  pageEntry(pageTables, pageTableIndex, pageNumber)->frame = frameNumber;
+  frameTable->frames[frameNumber].mapCount++;
+  addSharedMapper(pageTables, frameTable->frames[frameNumber].sharedPage, pageTableIndex);
+  tlbInsert(pageTableIndex, pageNumber, frameNumber);
+  if (result != NULL) {
+    result->frame = frameNumber;
+    result->fault = false;
+    result->evicted = false;
+    result->evictedDirty = false;
+    result->tlbHit = false;
+    result->copied = false;
+    result->evictedProcess = -1;
+    result->evictedPage = -1;
+  }
+}
+
+// Bring the page containing address into a frame. A shared page already in memory for
+// another process is just mapped, without a fault. With huge pages on, the whole huge
+// page around it is brought in if possible. Otherwise free frames are used first, then
+// the active replacement policy picks a victim whose page is unmapped. If result isn't
+// NULL it is filled in with the frame used and what was evicted from it.
+void replacePage(FrameTable* frameTable, uint64_t address, PageTable* pageTables, int pageTableIndex, AccessResult* result) {
+  long long pageNumber = address >> pageTables->pageShift;
+  int shared = sharedPageOf(pageTables, pageTableIndex, pageNumber);
+  if (shared != -1 && sharedFrames(pageTables)[shared] != -1) {
+    mapSharedPage(frameTable, pageTables, pageTableIndex, pageNumber, sharedFrames(pageTables)[shared], result);
+    return;
+  }
+  if (pageTables->config.hugePages && mapHugePage(frameTable, pageTables, pageTableIndex, pageNumber, result)) {
+    return;
+  }
+
+  bool evicted = false;
+  bool evictedDirty = false;
+  FrameOwner victim = { -1, -1 };
+
+  int index = findFreeFrame(frameTable);
+  if (index == -1) {
+    // Frames being written back by the page-out daemon hold no page and can't be taken
+    do {
+      index = replacementPolicy->chooseVictim(frameTable, pageTableIndex, pageNumber);
+    } while (frameTable->owners[index].process == -1);
+    evicted = true;
+    evictedDirty = frameBit(frameTable->dirty, index);
+    victim = frameTable->owners[index];
+    if (frameTable->frames[index].sharedPage != -1) victim.process = -1;
+    // Reset the page assigned to the frame
+    resetPageAtFrame(frameTable, index, pageTables);
+  } else {
+    // Take the frame out of the free pool
+    clearFrameBit(frameTable->freeFrames, index);
+    frameTable->freeCount--;
+  }
+
+  // Assign the frame to the page in the page table
+  pageEntry(pageTables, pageTableIndex, pageNumber)->frame = index;
+  clearFrameBit(frameTable->referenced, index);
+  clearFrameBit(frameTable->dirty, index);
+  frameTable->frames[index].reference_byte = 0;
+  frameTable->owners[index].process = pageTableIndex;
+  frameTable->owners[index].page = pageNumber;
+  frameTable->frames[index].sharedPage = shared;
+  frameTable->frames[index].mapCount = shared != -1 ? 1 : 0;
+  if (shared != -1) {
+    sharedFrames(pageTables)[shared] = index;
+    addSharedMapper(pageTables, shared, pageTableIndex);
+  }
+  tlbInsert(pageTableIndex, pageNumber, index);
+
+  replacementPolicy->inserted(frameTable, index, pageTableIndex, pageNumber);
+
+  if (result != NULL) {
+    result->frame = index;
+    result->fault = true;
+    result->evicted = evicted;
+    result->evictedDirty = evictedDirty;
+    result->tlbHit = false;
+    result->copied = false;
+    result->evictedProcess = victim.process;
+    result->evictedPage = victim.page;
+  }
+}
+
+// A process wrote to a shared page it maps. If no other process maps it, the frame just
+// becomes the process's own; otherwise the process gets a copy in another frame, which
+// displaces a page like a fault does. Either way the page is private to it from now on,
+// and written to.
+void copyOnWrite(FrameTable* frameTable, PageTable* pageTables, int pageTableIndex, long long pageNumber,
+  AccessResult* result) {
+  int frameNumber = result->frame;
+  Frame* frame = &(frameTable->frames[frameNumber]);
+  sharedCopies(pageTables, pageTableIndex)[frame->sharedPage] = true;
+
+  if (frame->mapCount == 1) {
+    removeSharedMapper(pageTables, frame->sharedPage, pageTableIndex);
+    sharedFrames(pageTables)[frame->sharedPage] = -1;
+    frame->sharedPage = -1;
+    frame->mapCount = 0;
+    frameTable->owners[frameNumber].process = pageTableIndex;
+  } else {
+    unmapSharedPage(frameTable, pageTables, pageTableIndex, frameNumber);
+    replacePage(frameTable, (uint64_t)pageNumber << pageTables->pageShift, pageTables, pageTableIndex, result);
+    result->copied = true;
+  }
+  setFrameBit(frameTable->dirty, result->frame);
+}
+
+// Perform one memory reference for a process. The translation is looked up in the
+// process's TLB first and the page table is only walked on a TLB miss. A hit is reported
+// to the replacement policy and a write marks the frame dirty, or copies a shared page;
+// a miss brings the page in with replacePage. The faulting reference itself doesn't
+// dirty the new frame; the process is simply unblocked once the page is in.
+AccessResult accessPage(FrameTable* frameTable, PageTable* pageTables, int pageTableIndex, uint64_t address, bool isRead) {
+  long long pageNumber = address >> pageTables->pageShift;
+  AccessResult result;
+  result.frame = tlbLookup(pageTableIndex, pageNumber);
+  result.fault = false;
+  result.evicted = false;
+  result.evictedDirty = false;
+  result.tlbHit = result.frame != -1;
+  result.copied = false;
+  result.evictedProcess = -1;
+  result.evictedPage = -1;
+
+  if (!result.tlbHit) {
+    result.frame = lookupPage(pageTables, pageTableIndex, pageNumber);
+    if (result.frame != -1) tlbInsert(pageTableIndex, pageNumber, result.frame);
+  }
+
+  if (result.frame == -1) {
+    replacePage(frameTable, address, pageTables, pageTableIndex, &result);
+    if (result.fault) return result;
+  }
+
+  recordAccess(frameTable, result.frame);
+  if (!isRead) {
+    if (frameTable->frames[result.frame].sharedPage != -1) {
+      copyOnWrite(frameTable, pageTables, pageTableIndex, pageNumber, &result);
     } else {
-      // If the reference byte is not triggered, mark it
-      if (frameTable->frames[index].reference_byte == 0) {
-        frameTable->frames[index].reference_byte = 1;
-      } else {
-        // Reset the page assigned to the frame and assign the new page
-        resetPageAtFrame(index, pageTables);
-        pageTables[pageTableIndex].pages[pageNumber].frame = index;
-        // printf("%d\n", index);
-        frameTable->frames[index].reference_byte = 0;
-        frameTable->frames[index].dirty_bit = 0;
-      }
+      setFrameBit(frameTable->dirty, result.frame);
     }
   }
+  return result;
 }
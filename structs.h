@@ -2,49 +2,192 @@
 #define STRUCTS_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 typedef struct {
   unsigned int seconds;
   unsigned int nanoseconds;
 } sclock_t;
 
+// An entry of a page table node. In a leaf node it maps one page to a frame. Above the
+// leaves it points to the node for the next level down, or, one level above the leaves,
+// may map the whole range that node would cover onto consecutive frames as a huge page.
 typedef struct {
-  int frame;
+  int frame; // frame holding the page, or the first frame of a huge page; -1 if none
+  int next;  // node for the next level down, -1 if none
 } Page;
 
+// Defaults used when oss isn't told otherwise
+#define DEFAULT_PROCESS_COUNT 18
+#define DEFAULT_PAGES_PER_PROCESS 32
+#define DEFAULT_FRAME_COUNT 256
+#define DEFAULT_PAGE_SIZE 1024
+
+// Widest virtual address space oss can simulate
+#define MAX_ADDRESS_BITS 48
+// Most page number bits a page table node indexes, giving nodes of 512 entries
+#define PAGE_LEVEL_BITS 9
+// Processes use their pages in runs of this many consecutive pages
+#define PAGE_CLUSTER 16
+// Simulated time to copy a shared page into a frame of the process that wrote to it
+#define PAGE_COPY_NANOS 2000
+
+// Size of the simulated system, chosen on the oss command line
 typedef struct {
-  Page pages[32];
+  int processCount;    // process slots that can run at once
+  int pagesPerProcess; // pages each process uses
+  int frameCount;      // frames of physical memory
+  int pageSize;        // bytes per page, a power of two
+  int addressBits;     // width of each process's virtual address space
+  bool hugePages;      // fault whole leaf nodes' worth of pages in at once when possible
+  int sharedPages;     // how many of each process's first pages are shared by every process
+} PagingConfig;
+
+// The page tables of every process slot. Each slot has a tree of nodes levels deep,
+// each node indexing levelBits bits of the page number, so 32- and 48-bit address
+// spaces are covered by four or fewer levels. Node p is the root of slot p. The other
+// nodes come from a pool in the same segment as pages are mapped, and go back to it when
+// the process exits, so the tables grow with the pages used rather than the address
+// space. The pool is sized for every process using all of its pages. After the nodes
+// come the frames of the shared pages and which of them each slot has its own copy of.
+typedef struct {
+  PagingConfig config;
+  int pageShift;
+  int levels;
+  int levelBits;
+  int nodeCount;
+  int freeNode; // first node of the free pool, chained through entry 0's next
+  int lock;     // guards the free pool when several threads map pages
+  Page nodes[];
 } PageTable;
 
+// Per-frame state that doesn't fit in a bit. Occupied, referenced and dirty are kept
+// in the frame table's bitmaps instead.
 typedef struct {
-  bool occupied;
-  int reference_byte;
-  int dirty_bit;
+  int reference_byte; // history byte for policies that age references
+  int sharedPage;     // index of the shared page the frame holds, -1 for a private page
+  int mapCount;       // page tables mapping a shared page's frame
 } Frame;
 
+// A slot's links in the list of slots mapping a shared page's frame
+typedef struct {
+  int prev;
+  int next;
+} SharedMapper;
+
+// Reverse mapping entry: which process slot and page currently own a frame. A shared
+// page's frame is owned by one of the processes mapping it, at the same page number in
+// all of them.
+typedef struct {
+  int process;
+  long long page;
+} FrameOwner;
+
+// Bits per bitmap word
+#define FRAME_WORD_BITS 64
+
+// The bitmaps and the frames and owners arrays are stored right after the header.
+// initializeFrameTable points them there, so the pointers are only valid in the process
+// that initialized it. Bit n of a bitmap is bit n % 64 of word n / 64.
 typedef struct {
-  Frame frames[256];
+  uint64_t* freeFrames; // set for every frame not holding a page
+  uint64_t* referenced; // set when a frame's page was referenced since the hand passed
+  uint64_t* dirty;      // set when a frame's page was written
+  Frame* frames;
+  FrameOwner* owners;
+  int frameCount;
+  int wordCount;
+  int freeCount; // frames in the free pool
+  int freeHint;  // no bitmap word before this one has a free frame
   int headIndex;
 } FrameTable;
 
+// Most memory references a process can send in one request
+#define MAX_REQUEST_BATCH 32
+
+typedef enum {
+  REQUEST_DONE,   // every reference of the request was served
+  REQUEST_FAULTED, // the last served reference faulted and the process blocked until its page was in
+  REQUEST_EXIT,    // from a pooled user process: its simulated process terminated
+  REQUEST_START,   // to a pooled user process: run the next simulated process, whose seed is
+                   // the one address carried
+  REQUEST_STOP     // to a pooled user process: the run is over
+} RequestStatus;
+
+// A batch of memory references from one process, and oss's reply to it. A request
+// carries count references in order; bit i of reads is set if reference i is a read. The
+// reply carries no references: oss serves them until one faults and says how many it
+// served in completed and why it stopped in status.
 typedef struct {
   long msg_type;
   int pid;
-  int address;
-  bool isRead;
+  int count;
+  int completed;
+  RequestStatus status;
+  uint32_t reads;
+  uint64_t addresses[MAX_REQUEST_BATCH];
 } MemoryRequest;
 
+// Outcome of one memory reference
+typedef struct {
+  int frame;         // frame holding the page after the reference
+  bool fault;        // the page wasn't resident and had to be brought in
+  bool evicted;      // a resident page was displaced to make room
+  bool evictedDirty; // the displaced page had been written to
+  bool tlbHit;       // the translation came from the TLB without walking the page table
+  bool copied;       // a write to a shared page gave the process a frame of its own, copied without I/O
+  int evictedProcess;     // slot and page number of the displaced page, when evicted is set; the
+  long long evictedPage;  // slot is -1 for a shared page, which is never dirty
+} AccessResult;
+
 void print_clock(sclock_t* clock);
 void increment_clock(sclock_t* clock, unsigned int nanoseconds);
 unsigned int time_between_nano(sclock_t clock1, sclock_t clock2);
 
-void initializePageTables(PageTable* pageTables);
-void initializeFrameTable(FrameTable* frameTable);
-void printFrameTable(const FrameTable* frameTable, sclock_t* clock);
+// Convert a clock to total nanoseconds without wrapping. Inline so programs that only
+// read the clock, like ossstat, don't link the paging engine.
+static inline unsigned long long clock_to_nano(sclock_t clock) {
+  return clock.seconds * 1000000000ULL + clock.nanoseconds;
+}
+
+void defaultPagingConfig(PagingConfig* config);
+int denseAddressBits(const PagingConfig* config);
+bool checkPagingConfig(const PagingConfig* config);
+long long processPageNumber(const PagingConfig* config, int n);
+size_t pageTablesSize(const PagingConfig* config);
+size_t frameTableSize(int frameCount);
 
-int getFrameFromAddr(int address, PageTable* pageTables, int pageTableIndex);
-void resetPageAtFrame(int frameNumber, PageTable* pageTables);
+void initializePageTables(PageTable* pageTables, const PagingConfig* config);
+void initializeFrameTable(FrameTable* frameTable, int frameCount);
+Page* pageEntry(PageTable* pageTables, int pageTableIndex, long long pageNumber);
+Page* findPageEntry(PageTable* pageTables, int pageTableIndex, long long pageNumber);
+int lookupPage(PageTable* pageTables, int pageTableIndex, long long pageNumber);
+void freeProcessPageTable(PageTable* pageTables, int pageTableIndex);
+int sharedPageIndex(const PageTable* pageTables, long long pageNumber);
+void clearSharedCopies(PageTable* pageTables, int pageTableIndex);
+
+int getFrameFromAddr(uint64_t address, PageTable* pageTables, int pageTableIndex);
+void resetPageAtFrame(FrameTable* frameTable, int frameNumber, PageTable* pageTables);
 void removeProcessPages(FrameTable* frameTable, PageTable* pageTables, int pageTableIndex);
-void replacePage(FrameTable* frameTable, int address, PageTable* pageTables, int pageTableIndex);
+void recordAccess(FrameTable* frameTable, int frameNumber);
+int findFreeFrame(FrameTable* frameTable);
+int findFreeRun(FrameTable* frameTable, int count);
+void releaseFrame(FrameTable* frameTable, int frameNumber);
+int sweepReferenced(FrameTable* frameTable, int start);
+void replacePage(FrameTable* frameTable, uint64_t address, PageTable* pageTables, int pageTableIndex, AccessResult* result);
+AccessResult accessPage(FrameTable* frameTable, PageTable* pageTables, int pageTableIndex, uint64_t address, bool isRead);
+
+static inline bool frameBit(const uint64_t* bitmap, int frameNumber) {
+  return (bitmap[frameNumber / FRAME_WORD_BITS] >> (frameNumber % FRAME_WORD_BITS)) & 1;
+}
+
+static inline void setFrameBit(uint64_t* bitmap, int frameNumber) {
+  bitmap[frameNumber / FRAME_WORD_BITS] |= 1ULL << (frameNumber % FRAME_WORD_BITS);
+}
+
+static inline void clearFrameBit(uint64_t* bitmap, int frameNumber) {
+  bitmap[frameNumber / FRAME_WORD_BITS] &= ~(1ULL << (frameNumber % FRAME_WORD_BITS));
+}
 
 #endif /* STRUCTS_H */
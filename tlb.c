@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tlb.h"
+
+TlbConfig tlbConfig = { DEFAULT_TLB_ENTRIES, DEFAULT_TLB_WAYS, TLB_LRU };
+
+// Every slot's TLB is stored back to back, one set of ways entries after another, so
+// a lookup only compares the tags of one short contiguous run. A tag is the page
+// number plus one, leaving 0 for an empty entry so a flush is a memset.
+unsigned long long* tlbTags;
+int* tlbFrames;
+unsigned long long* tlbStamps; // last use (LRU) or fill (FIFO) of each entry
+unsigned long long tlbTime;
+unsigned int tlbSeed = 1;
+int tlbSetMask;
+
+const char* tlbReplacementNames[] = { "lru", "fifo", "random" };
+
+// Convert a command-line name ("lru", "fifo" or "random") to a TLB replacement policy
+bool parseTlbReplacement(const char* name, TlbReplacement* replacement) {
+  int i;
+  for (i = 0; i <= TLB_RANDOM; i++) {
+    if (strcmp(tlbReplacementNames[i], name) == 0) {
+      *replacement = (TlbReplacement)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* tlbReplacementName(TlbReplacement replacement) {
+  return tlbReplacementNames[replacement];
+}
+
+// Check that a TLB shape is usable, printing the problem if it isn't
+bool checkTlbConfig(const TlbConfig* config) {
+  if (config->entries == 0) return true;
+  if (config->entries < 0 || (config->entries & (config->entries - 1)) != 0) {
+    fprintf(stderr, "TLB entries %d is not 0 or a power of two\n", config->entries);
+    return false;
+  }
+  if (config->ways < 1 || config->ways > config->entries || (config->ways & (config->ways - 1)) != 0) {
+    fprintf(stderr, "TLB ways %d is not a power of two up to the %d entries\n", config->ways, config->entries);
+    return false;
+  }
+  return true;
+}
+
+// Give every process slot an empty TLB shaped by tlbConfig. Does nothing if the TLB
+// is turned off.
+bool initTlb(int slotCount) {
+  freeTlb();
+  if (tlbConfig.entries == 0) return true;
+
+  size_t count = (size_t)slotCount * tlbConfig.entries;
+  tlbTags = calloc(count, sizeof(unsigned long long));
+  tlbFrames = calloc(count, sizeof(int));
+  tlbStamps = calloc(count, sizeof(unsigned long long));
+  if (tlbTags == NULL || tlbFrames == NULL || tlbStamps == NULL) {
+    perror("calloc");
+    freeTlb();
+    return false;
+  }
+  tlbSetMask = tlbConfig.entries / tlbConfig.ways - 1;
+  tlbTime = 0;
+  return true;
+}
+
+void freeTlb() {
+  free(tlbTags);
+  free(tlbFrames);
+  free(tlbStamps);
+  tlbTags = NULL;
+  tlbFrames = NULL;
+  tlbStamps = NULL;
+}
+
+bool tlbEnabled() {
+  return tlbTags != NULL;
+}
+
+// Index of the first entry of the set a page maps to
+int tlbSet(int slot, long long pageNumber) {
+  return slot * tlbConfig.entries + (pageNumber & tlbSetMask) * tlbConfig.ways;
+}
+
+// Frame cached for a page of the process in a slot, or -1 on a TLB miss
+int tlbLookup(int slot, long long pageNumber) {
+  if (tlbTags == NULL) return -1;
+
+  int set = tlbSet(slot, pageNumber);
+  unsigned long long tag = pageNumber + 1;
+  int i;
+  for (i = 0; i < tlbConfig.ways; i++) {
+    if (tlbTags[set + i] == tag) {
+      if (tlbConfig.replacement == TLB_LRU) tlbStamps[set + i] = ++tlbTime;
+      return tlbFrames[set + i];
+    }
+  }
+  return -1;
+}
+
+// Cache a translation after a page table walk, displacing an entry of its set if the
+// set is full
+void tlbInsert(int slot, long long pageNumber, int frameNumber) {
+  if (tlbTags == NULL) return;
+
+  int set = tlbSet(slot, pageNumber);
+  int victim = -1;
+  int i;
+  for (i = 0; i < tlbConfig.ways && victim == -1; i++) {
+    if (tlbTags[set + i] == 0) victim = i;
+  }
+  if (victim == -1) {
+    if (tlbConfig.replacement == TLB_RANDOM) {
+      victim = rand_r(&tlbSeed) % tlbConfig.ways;
+    } else {
+      victim = 0;
+      for (i = 1; i < tlbConfig.ways; i++) {
+        if (tlbStamps[set + i] < tlbStamps[set + victim]) victim = i;
+      }
+    }
+  }
+
+  tlbTags[set + victim] = pageNumber + 1;
+  tlbFrames[set + victim] = frameNumber;
+  tlbStamps[set + victim] = ++tlbTime;
+}
+
+// Drop the translation of a page that is no longer in its frame
+void tlbInvalidate(int slot, long long pageNumber) {
+  if (tlbTags == NULL) return;
+
+  int set = tlbSet(slot, pageNumber);
+  unsigned long long tag = pageNumber + 1;
+  int i;
+  for (i = 0; i < tlbConfig.ways; i++) {
+    if (tlbTags[set + i] == tag) {
+      tlbTags[set + i] = 0;
+      return;
+    }
+  }
+}
+
+// Drop every translation of the process in a slot
+void tlbFlush(int slot) {
+  if (tlbTags == NULL) return;
+
+  memset(&tlbTags[slot * tlbConfig.entries], 0, sizeof(unsigned long long) * tlbConfig.entries);
+}
@@ -0,0 +1,44 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdbool.h>
+
+// Simulated time to translate an address found in the TLB and one that has to walk
+// the page table
+#define TLB_HIT_NANOS 10
+#define PAGE_WALK_NANOS 100
+
+// Defaults used when oss isn't told otherwise
+#define DEFAULT_TLB_ENTRIES 16
+#define DEFAULT_TLB_WAYS 4
+
+typedef enum {
+  TLB_LRU,    // evict the entry used longest ago
+  TLB_FIFO,   // evict the entry filled longest ago
+  TLB_RANDOM  // evict any entry of the set
+} TlbReplacement;
+
+// Shape of the TLB each process slot gets. entries and ways are powers of two; a TLB
+// with as many ways as entries is fully associative, and 0 entries turns it off.
+typedef struct {
+  int entries;
+  int ways;
+  TlbReplacement replacement;
+} TlbConfig;
+
+extern TlbConfig tlbConfig;
+
+bool parseTlbReplacement(const char* name, TlbReplacement* replacement);
+const char* tlbReplacementName(TlbReplacement replacement);
+bool checkTlbConfig(const TlbConfig* config);
+
+bool initTlb(int slotCount);
+void freeTlb();
+bool tlbEnabled();
+
+int tlbLookup(int slot, long long pageNumber);
+void tlbInsert(int slot, long long pageNumber, int frameNumber);
+void tlbInvalidate(int slot, long long pageNumber);
+void tlbFlush(int slot);
+
+#endif /* TLB_H */
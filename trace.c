@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+
+// Size of the stdio buffer used when recording, so records go out in large writes
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+// Create a trace file and write its header
+bool openTraceWriter(TraceWriter* writer, const char* path, const PagingConfig* config) {
+  writer->file = fopen(path, "wb");
+  if (writer->file == NULL) {
+    perror("fopen");
+    return false;
+  }
+
+  writer->buffer = malloc(TRACE_BUFFER_SIZE);
+  if (writer->buffer != NULL) {
+    setvbuf(writer->file, writer->buffer, _IOFBF, TRACE_BUFFER_SIZE);
+  }
+
+  TraceHeader header;
+  header.magic = TRACE_MAGIC;
+  header.version = TRACE_VERSION;
+  header.recordSize = sizeof(TraceRecord);
+  header.processCount = config->processCount;
+  header.pagesPerProcess = config->pagesPerProcess;
+  header.frameCount = config->frameCount;
+  header.pageSize = config->pageSize;
+  header.addressBits = config->addressBits;
+  header.hugePages = config->hugePages;
+  header.sharedPages = config->sharedPages;
+  if (fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+    perror("fwrite");
+    return false;
+  }
+  return true;
+}
+
+// Append one record to the trace
+void writeTraceRecord(TraceWriter* writer, TraceRecordType type, uint64_t time, int pid, int slot, uint64_t address, bool isRead) {
+  if (writer->file == NULL) return;
+
+  TraceRecord record;
+  record.time = time;
+  record.pid = pid;
+  record.address = address;
+  record.slot = slot;
+  record.type = type;
+  record.isRead = isRead;
+  fwrite(&record, sizeof(record), 1, writer->file);
+}
+
+// Flush and close the trace
+void closeTraceWriter(TraceWriter* writer) {
+  if (writer->file == NULL) return;
+
+  fclose(writer->file);
+  free(writer->buffer);
+  writer->file = NULL;
+  writer->buffer = NULL;
+}
+
+// Map a trace file into memory and check its header
+bool openTraceReader(TraceReader* reader, const char* path) {
+  reader->map = NULL;
+  reader->records = NULL;
+  reader->recordCount = 0;
+
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    perror("open");
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) == -1) {
+    perror("fstat");
+    close(fd);
+    return false;
+  }
+  if ((size_t)info.st_size < sizeof(TraceHeader)) {
+    fprintf(stderr, "%s is not a trace file\n", path);
+    close(fd);
+    return false;
+  }
+
+  reader->mapSize = info.st_size;
+  reader->map = mmap(NULL, reader->mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (reader->map == MAP_FAILED) {
+    perror("mmap");
+    reader->map = NULL;
+    return false;
+  }
+
+  const TraceHeader* header = (const TraceHeader*)reader->map;
+  if (header->magic != TRACE_MAGIC || header->version != TRACE_VERSION || header->recordSize != sizeof(TraceRecord)) {
+    fprintf(stderr, "%s is not a version %d trace file\n", path, TRACE_VERSION);
+    closeTraceReader(reader);
+    return false;
+  }
+
+  reader->config.processCount = header->processCount;
+  reader->config.pagesPerProcess = header->pagesPerProcess;
+  reader->config.frameCount = header->frameCount;
+  reader->config.pageSize = header->pageSize;
+  reader->config.addressBits = header->addressBits;
+  reader->config.hugePages = header->hugePages != 0;
+  reader->config.sharedPages = header->sharedPages;
+
+  // The records are read front to back exactly once
+  madvise(reader->map, reader->mapSize, MADV_SEQUENTIAL);
+  reader->records = (const TraceRecord*)((const char*)reader->map + sizeof(TraceHeader));
+  reader->recordCount = (reader->mapSize - sizeof(TraceHeader)) / sizeof(TraceRecord);
+  return true;
+}
+
+void closeTraceReader(TraceReader* reader) {
+  if (reader->map != NULL) munmap(reader->map, reader->mapSize);
+  reader->map = NULL;
+  reader->records = NULL;
+  reader->recordCount = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "structs.h"
+
+#define TRACE_MAGIC 0x4352545353534fULL // "OSSSTRC"
+#define TRACE_VERSION 4
+
+typedef enum {
+  TRACE_ACCESS = 0, // a memory reference
+  TRACE_EXIT = 1    // the process in slot terminated and its frames were freed
+} TraceRecordType;
+
+typedef struct {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t recordSize;
+  // Size of the system the trace was recorded on
+  uint32_t processCount;
+  uint32_t pagesPerProcess;
+  uint32_t frameCount;
+  uint32_t pageSize;
+  uint32_t addressBits;
+  uint32_t hugePages;
+  uint32_t sharedPages;
+} TraceHeader;
+
+typedef struct {
+  uint64_t time; // simulated time in nanoseconds
+  uint64_t address;
+  int32_t pid;
+  uint16_t slot;
+  uint8_t type;
+  uint8_t isRead;
+} TraceRecord;
+
+typedef struct {
+  FILE* file;
+  char* buffer;
+} TraceWriter;
+
+typedef struct {
+  void* map;
+  size_t mapSize;
+  const TraceRecord* records;
+  size_t recordCount;
+  PagingConfig config;
+} TraceReader;
+
+bool openTraceWriter(TraceWriter* writer, const char* path, const PagingConfig* config);
+void writeTraceRecord(TraceWriter* writer, TraceRecordType type, uint64_t time, int pid, int slot, uint64_t address, bool isRead);
+void closeTraceWriter(TraceWriter* writer);
+
+bool openTraceReader(TraceReader* reader, const char* path);
+void closeTraceReader(TraceReader* reader);
+
+#endif /* TRACE_H */
@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "shared_memory.h"
+#include "transport.h"
+
+// Convert a command-line name ("msgq", "ring" or "thread") to a transport mode
+bool parseTransportMode(const char* name, TransportMode* mode) {
+  if (strcmp(name, "msgq") == 0) {
+    *mode = TRANSPORT_MSGQ;
+    return true;
+  }
+  if (strcmp(name, "ring") == 0) {
+    *mode = TRANSPORT_RING;
+    return true;
+  }
+  if (strcmp(name, "thread") == 0) {
+    *mode = TRANSPORT_THREAD;
+    return true;
+  }
+  return false;
+}
+
+// Bytes of a request or reply carrying count references. Only these are copied through
+// the rings and the message queue.
+size_t requestSize(int count) {
+  return offsetof(MemoryRequest, addresses) + sizeof(uint64_t) * count;
+}
+
+// Push a request onto a ring, returning false if the ring is full
+bool ringPush(RequestRing* ring, const MemoryRequest* request) {
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  if (tail - head == RING_SIZE) return false;
+
+  memcpy(&ring->entries[tail & (RING_SIZE - 1)], request, requestSize(request->count));
+  atomic_store(&ring->tail, tail + 1);
+
+  // Wake the consumer if it went to sleep on an empty ring
+  if (atomic_load(&ring->sleeping)) {
+    syscall(SYS_futex, &ring->tail, FUTEX_WAKE, 1, NULL, NULL, 0);
+  }
+  return true;
+}
+
+// Pop a request from a ring, returning false if the ring is empty
+bool ringPop(RequestRing* ring, MemoryRequest* request) {
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  if (head == tail) return false;
+
+  const MemoryRequest* entry = &ring->entries[head & (RING_SIZE - 1)];
+  memcpy(request, entry, requestSize(entry->count));
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  return true;
+}
+
+// Pop a request, spinning briefly and then sleeping until the producer pushes one
+void ringWaitPop(RequestRing* ring, MemoryRequest* request) {
+  int spins = 0;
+  while (!ringPop(ring, request)) {
+    if (spins++ < RING_SPIN_LIMIT) continue;
+
+    unsigned int tail = atomic_load(&ring->tail);
+    atomic_store(&ring->sleeping, 1);
+    // Re-check after announcing we're asleep so a concurrent push can't be missed
+    if (atomic_load(&ring->head) == tail) {
+      syscall(SYS_futex, &ring->tail, FUTEX_WAIT, tail, NULL, NULL, 0);
+    }
+    atomic_store(&ring->sleeping, 0);
+  }
+}
+
+// Empty both rings of a slot before a new process starts using it
+void resetChannel(Transport* transport, int slot) {
+  if (transport->mode == TRANSPORT_MSGQ) return;
+
+  ProcessChannel* channel = &(transport->channels[slot]);
+  atomic_store(&channel->requests.head, 0);
+  atomic_store(&channel->requests.tail, 0);
+  atomic_store(&channel->responses.head, 0);
+  atomic_store(&channel->responses.tail, 0);
+  atomic_store(&channel->requests.sleeping, 0);
+  atomic_store(&channel->responses.sleeping, 0);
+}
+
+// Open the message queue, attach the shared ring block, or allocate the ring block in
+// this process's memory for user threads
+bool openTransport(Transport* transport, TransportMode mode, int slotCount) {
+  transport->mode = mode;
+  transport->msgqid = -1;
+  transport->block = NULL;
+  transport->channels = NULL;
+  transport->slotCount = slotCount;
+  transport->nextSlot = 0;
+  transport->consumer = 0;
+  transport->consumerCount = 1;
+
+  if (mode == TRANSPORT_MSGQ) {
+    key_t key = ftok(".", 'm');
+    transport->msgqid = msgget(key, IPC_CREAT | 0666);
+    if (transport->msgqid == -1) {
+      perror("msgget");
+      return false;
+    }
+  } else if (mode == TRANSPORT_THREAD) {
+    size_t size = sizeof(ChannelBlock) + sizeof(ProcessChannel) * slotCount;
+    transport->block = (ChannelBlock*)aligned_alloc(64, (size + 63) / 64 * 64);
+    if (transport->block == NULL) {
+      perror("aligned_alloc");
+      return false;
+    }
+    memset(transport->block, 0, size);
+    atomic_store(&transport->block->consumerCount, 1);
+    transport->channels = transport->block->channels;
+  } else {
+    transport->block = (ChannelBlock*)attach_memory_block("transport.c", sizeof(ChannelBlock) + sizeof(ProcessChannel) * slotCount);
+    if (transport->block == NULL) {
+      perror("attach_memory_block");
+      return false;
+    }
+    // oss's block starts out served by a single consumer
+    if (atomic_load(&transport->block->consumerCount) == 0) {
+      atomic_store(&transport->block->consumerCount, 1);
+    }
+    transport->channels = transport->block->channels;
+  }
+  return true;
+}
+
+// Detach from the transport, removing the kernel objects if destroy is set
+void closeTransport(Transport* transport, bool destroy) {
+  if (transport->mode == TRANSPORT_MSGQ) {
+    if (destroy && msgctl(transport->msgqid, IPC_RMID, NULL) == -1) {
+      perror("msgctl failed");
+      exit(1);
+    }
+  } else if (transport->mode == TRANSPORT_THREAD) {
+    free(transport->block);
+  } else {
+    detach_memory_block((void*)transport->block);
+    if (destroy) destroy_memory_block("transport.c");
+  }
+}
+
+// Divide the request rings between consumerCount threads. consumers[i] is set up to
+// receive requests from slots i, i + consumerCount, ... and to sleep on its own
+// doorbell. Only used with the ring and thread transports.
+void splitTransport(Transport* transport, Transport* consumers, int consumerCount) {
+  int i;
+  for (i = 0; i < consumerCount; i++) {
+    consumers[i] = *transport;
+    consumers[i].consumer = i;
+    consumers[i].consumerCount = consumerCount;
+    consumers[i].nextSlot = 0;
+  }
+  atomic_store(&transport->block->consumerCount, consumerCount);
+}
+
+// Non-blocking receive of the next request for oss. slot is set to the sender's
+// process slot when the transport knows it, or -1 otherwise.
+bool receiveRequest(Transport* transport, MemoryRequest* request, int* slot) {
+  *slot = -1;
+
+  if (transport->mode == TRANSPORT_MSGQ) {
+    if (msgrcv(transport->msgqid, request, sizeof(MemoryRequest) - sizeof(long), 1, IPC_NOWAIT) == -1) {
+      if (errno != ENOMSG) { // Ignore ENOMSG errors
+        perror("msgrcv failed");
+        exit(1);
+      }
+      return false;
+    }
+    // A pid of 0 is a wakeup posted by wakeTransport, not a real request
+    return request->pid != 0;
+  }
+
+  // Poll this consumer's slots round-robin so no process can starve the others
+  int count = (transport->slotCount - transport->consumer + transport->consumerCount - 1) / transport->consumerCount;
+  int i;
+  for (i = 0; i < count; i++) {
+    int k = (transport->nextSlot + i) % count;
+    int index = transport->consumer + k * transport->consumerCount;
+    if (ringPop(&transport->channels[index].requests, request)) {
+      transport->nextSlot = (k + 1) % count;
+      *slot = index;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Send oss's reply back to the process that made a request. On the message queue a
+// reply is addressed to the slot rather than the pid, so a pooled user process picks up
+// replies to every simulated process it runs.
+void sendResponse(Transport* transport, MemoryRequest* request, int slot) {
+  if (transport->mode == TRANSPORT_MSGQ) {
+    request->msg_type = MSGQ_REPLY_TYPE(slot);
+    if (msgsnd(transport->msgqid, request, requestSize(request->count) - sizeof(long), 0) == -1) {
+      perror("msgsnd");
+      exit(1);
+    }
+    return;
+  }
+
+  while (!ringPush(&transport->channels[slot].responses, request)) {
+    sched_yield();
+  }
+}
+
+// Send a request from user_proc to oss
+void sendRequest(Transport* transport, MemoryRequest* request, int slot) {
+  if (transport->mode == TRANSPORT_MSGQ) {
+    request->msg_type = 1;
+    if (msgsnd(transport->msgqid, request, requestSize(request->count) - sizeof(long), 0) == -1) {
+      perror("msgsnd");
+      exit(1);
+    }
+    return;
+  }
+
+  while (!ringPush(&transport->channels[slot].requests, request)) {
+    sched_yield();
+  }
+
+  // Ring the doorbell of the oss thread serving this slot if it is asleep waiting for work
+  Doorbell* doorbell = &transport->block->doorbells[slot % atomic_load(&transport->block->consumerCount)];
+  if (atomic_load(&doorbell->sleeping)) {
+    atomic_fetch_add(&doorbell->value, 1);
+    syscall(SYS_futex, &doorbell->value, FUTEX_WAKE, 1, NULL, NULL, 0);
+  }
+}
+
+// Block user_proc until oss replies to its outstanding request
+void receiveResponse(Transport* transport, MemoryRequest* request, int slot) {
+  if (transport->mode == TRANSPORT_MSGQ) {
+    if (msgrcv(transport->msgqid, request, sizeof(MemoryRequest) - sizeof(long), MSGQ_REPLY_TYPE(slot), 0) == -1) {
+      if (errno != ENOMSG) { // Ignore ENOMSG errors
+        perror("msgrcv failed");
+        exit(1);
+      }
+    }
+    return;
+  }
+
+  ringWaitPop(&transport->channels[slot].responses, request);
+}
+
+// Announce that oss is about to sleep. Any wakeTransport or request sent after this
+// returns makes the matching waitForRequest return instead of sleeping.
+unsigned int prepareWait(Transport* transport) {
+  if (transport->mode == TRANSPORT_MSGQ) return 0;
+
+  Doorbell* doorbell = &transport->block->doorbells[transport->consumer];
+  atomic_store(&doorbell->sleeping, 1);
+  atomic_thread_fence(memory_order_seq_cst);
+  return atomic_load(&doorbell->value);
+}
+
+// Sleep until a request arrives or wakeTransport is called. Returns true with the
+// request filled in if one arrived, or false if oss was woken for another reason.
+bool waitForRequest(Transport* transport, unsigned int ticket, MemoryRequest* request, int* slot) {
+  *slot = -1;
+
+  if (transport->mode == TRANSPORT_MSGQ) {
+    if (msgrcv(transport->msgqid, request, sizeof(MemoryRequest) - sizeof(long), 1, 0) == -1) {
+      if (errno != EINTR) {
+        perror("msgrcv failed");
+        exit(1);
+      }
+      return false;
+    }
+    return request->pid != 0;
+  }
+
+  Doorbell* doorbell = &transport->block->doorbells[transport->consumer];
+  bool received = receiveRequest(transport, request, slot);
+  if (!received) {
+    syscall(SYS_futex, &doorbell->value, FUTEX_WAIT, ticket, NULL, NULL, 0);
+    received = receiveRequest(transport, request, slot);
+  }
+  atomic_store(&doorbell->sleeping, 0);
+  return received;
+}
+
+// Back out of prepareWait when oss decides not to sleep after all
+void cancelWait(Transport* transport) {
+  if (transport->mode == TRANSPORT_MSGQ) return;
+
+  atomic_store(&transport->block->doorbells[transport->consumer].sleeping, 0);
+}
+
+// Wake the thread using this handle out of waitForRequest. Only makes async-signal-safe
+// calls so it can be used from the SIGCHLD handler.
+void wakeTransport(Transport* transport) {
+  if (transport->mode == TRANSPORT_MSGQ) {
+    MemoryRequest wakeup;
+    memset(&wakeup, 0, sizeof(wakeup));
+    wakeup.msg_type = 1;
+    msgsnd(transport->msgqid, &wakeup, requestSize(0) - sizeof(long), IPC_NOWAIT);
+    return;
+  }
+
+  Doorbell* doorbell = &transport->block->doorbells[transport->consumer];
+  atomic_fetch_add(&doorbell->value, 1);
+  syscall(SYS_futex, &doorbell->value, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
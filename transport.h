@@ -0,0 +1,95 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "structs.h"
+
+// Number of entries in each ring; must be a power of two
+#define RING_SIZE 16
+
+typedef enum {
+  TRANSPORT_MSGQ,
+  TRANSPORT_RING,
+  TRANSPORT_THREAD // rings in oss's own memory, used by user processes run as threads
+} TransportMode;
+
+// Message type of replies to the process in a slot; requests to oss are type 1
+#define MSGQ_REPLY_TYPE(slot) ((long)(slot) + 2)
+
+// Number of times a consumer polls an empty ring before sleeping on it
+#define RING_SPIN_LIMIT 100
+
+// Most threads that can split the request rings between them, each with its own doorbell
+#define TRANSPORT_MAX_CONSUMERS 64
+
+// Lock-free single-producer/single-consumer ring of memory requests.
+// head and tail live on separate cache lines so producer and consumer don't share one.
+// A consumer that runs out of work sets sleeping and waits on tail with a futex.
+typedef struct {
+  _Atomic unsigned int head;
+  _Atomic unsigned int sleeping;
+  char headPad[64 - 2 * sizeof(unsigned int)];
+  _Atomic unsigned int tail;
+  char tailPad[64 - sizeof(unsigned int)];
+  MemoryRequest entries[RING_SIZE];
+} RequestRing;
+
+// A process slot's pair of rings: user_proc -> oss requests and oss -> user_proc responses
+typedef struct {
+  RequestRing requests;
+  RequestRing responses;
+} ProcessChannel;
+
+// A counter a consumer sleeps on when all of its rings are empty
+typedef struct {
+  _Atomic unsigned int value;
+  _Atomic unsigned int sleeping;
+  char pad[64 - 2 * sizeof(unsigned int)];
+} Doorbell;
+
+// Shared ring block: one doorbell per consumer, followed by one channel per process
+// slot. Requests from slot s are served by consumer s % consumerCount.
+typedef struct {
+  _Atomic unsigned int consumerCount;
+  char pad[64 - sizeof(unsigned int)];
+  Doorbell doorbells[TRANSPORT_MAX_CONSUMERS];
+  ProcessChannel channels[];
+} ChannelBlock;
+
+typedef struct {
+  TransportMode mode;
+  int msgqid;
+  ChannelBlock* block;
+  ProcessChannel* channels;
+  int slotCount;
+  int nextSlot;
+  int consumer;      // which consumer's slots and doorbell this handle uses
+  int consumerCount;
+} Transport;
+
+bool parseTransportMode(const char* name, TransportMode* mode);
+
+size_t requestSize(int count);
+
+bool ringPush(RequestRing* ring, const MemoryRequest* request);
+bool ringPop(RequestRing* ring, MemoryRequest* request);
+void ringWaitPop(RequestRing* ring, MemoryRequest* request);
+void resetChannel(Transport* transport, int slot);
+
+bool openTransport(Transport* transport, TransportMode mode, int slotCount);
+void closeTransport(Transport* transport, bool destroy);
+void splitTransport(Transport* transport, Transport* consumers, int consumerCount);
+
+bool receiveRequest(Transport* transport, MemoryRequest* request, int* slot);
+void sendResponse(Transport* transport, MemoryRequest* request, int slot);
+void sendRequest(Transport* transport, MemoryRequest* request, int slot);
+void receiveResponse(Transport* transport, MemoryRequest* request, int slot);
+
+unsigned int prepareWait(Transport* transport);
+bool waitForRequest(Transport* transport, unsigned int ticket, MemoryRequest* request, int* slot);
+void cancelWait(Transport* transport);
+void wakeTransport(Transport* transport);
+
+#endif /* TRANSPORT_H */
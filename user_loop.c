@@ -0,0 +1,79 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "user_loop.h"
+
+// Make memory requests from the process's workload until it decides to terminate. Used
+// by the user_proc executable and by user processes run as threads inside oss, so all
+// its random state lives in the workload rather than in rand()'s global one.
+void runUserLoop(UserLoop* loop) {
+  Workload workload;
+  if (!initWorkload(&workload, &loop->workload, &loop->config, loop->seed)) {
+    return;
+  }
+
+  int termInterval = workloadRandom(&workload) % 201 + 900; // Random termination interval between 900 and 1100
+  int requestsSinceLastCheck = 0; // Counter to keep track of the number of memory requests since the last termination interval check
+
+  MemoryRequest request;
+  request.pid = loop->pid;
+  request.count = 0;
+  request.reads = 0;
+  request.status = REQUEST_DONE;
+
+  while (true) {
+    if (requestsSinceLastCheck >= termInterval) {
+      int shouldTerm = workloadRandom(&workload) % 2; // Randomly decide whether to terminate or continue
+      if (shouldTerm) {
+        freeWorkload(&workload);
+        return; // Terminate the process
+      } else {
+        termInterval = workloadRandom(&workload) % 201 + 900; // Generate a new termination interval for the next round
+        requestsSinceLastCheck = 0; // Reset the counter
+      }
+    }
+
+    // Top the batch up with the next addresses, and whether they are read or written,
+    // from the workload
+    while (request.count < loop->batch) {
+      bool isRead;
+      nextReference(&workload, &request.addresses[request.count], &isRead);
+      if (isRead) request.reads |= 1U << request.count;
+      request.count++;
+    }
+
+    sendRequest(loop->transport, &request, loop->slot);
+
+    MemoryRequest reply;
+    receiveResponse(loop->transport, &reply, loop->slot);
+    requestsSinceLastCheck += reply.completed;
+
+    // Keep the references oss didn't get to because of a fault for the next request
+    request.count -= reply.completed;
+    memmove(request.addresses, &request.addresses[reply.completed], sizeof(uint64_t) * request.count);
+    request.reads = reply.completed < 32 ? request.reads >> reply.completed : 0;
+  }
+}
+
+// Run simulated processes one after another for as long as oss hands them out, so a
+// pooled user process is forked and attaches to the transport only once. Each one
+// starts when oss sends its pid and seed, and ends with a request telling oss it has
+// terminated in place of the exit oss would otherwise reap.
+void runUserPool(UserLoop* loop) {
+  while (true) {
+    MemoryRequest start;
+    receiveResponse(loop->transport, &start, loop->slot);
+    if (start.status != REQUEST_START) return;
+    loop->pid = start.pid;
+    loop->seed = start.addresses[0];
+    runUserLoop(loop);
+
+    MemoryRequest done;
+    done.pid = loop->pid;
+    done.count = 0;
+    done.reads = 0;
+    done.status = REQUEST_EXIT;
+    sendRequest(loop->transport, &done, loop->slot);
+  }
+}
@@ -0,0 +1,23 @@
+#ifndef USER_LOOP_H
+#define USER_LOOP_H
+
+#include "structs.h"
+#include "transport.h"
+#include "workload.h"
+
+// What a user process needs to know to run: where to send requests, who it is, the
+// shape of its address space, the references it makes and how many go in each request
+typedef struct {
+  Transport* transport;
+  int slot;
+  int pid;
+  PagingConfig config;
+  WorkloadConfig workload;
+  int batch;
+  uint64_t seed;
+} UserLoop;
+
+void runUserLoop(UserLoop* loop);
+void runUserPool(UserLoop* loop);
+
+#endif /* USER_LOOP_H */
@@ -23,52 +23,101 @@
 
 #include "shared_memory.h"
 #include "structs.h"
+#include "transport.h"
+#include "user_loop.h"
 
 int main(int argc, char const* argv[]) {
-  srand(time(NULL) ^ getpid());
+  TransportMode transportMode = TRANSPORT_MSGQ;
+  int slot = -1;
+  PagingConfig config;
+  defaultPagingConfig(&config);
+  WorkloadConfig workload;
+  defaultWorkloadConfig(&workload);
+  uint64_t seed = time(NULL) ^ getpid();
+  int batch = 1;
+  bool pooled = false;
 
-  int msgqid;
-  key_t key = ftok(".", 'm');
-  msgqid = msgget(key, IPC_CREAT | 0666);
-  if (msgqid == -1) {
-    perror("msgget");
-    exit(1);
-  }
-
-  int termInterval = rand() % 201 + 900; // Random termination interval between 900 and 1100
-  int requestsSinceLastCheck = 0; // Counter to keep track of the number of memory requests since the last termination interval check
-
-  while (true) {
-    if (requestsSinceLastCheck >= termInterval) {
-      int shouldTerm = rand() % 2; // Randomly decide whether to terminate or continue
-      if (shouldTerm) {
-        return 0; // Terminate the process
-      } else {
-        int termInterval = rand() % 201 + 900; // Generate a new termination interval for the next round
-        requestsSinceLastCheck = 0; // Reset the counter
+  // oss passes the transport, the process slot this process was assigned, the shape of
+  // its address space, the workload it runs with its seed and the references per request.
+  // A pooled process gets no seed; oss sends one with each simulated process it runs.
+  int opt;
+  while ((opt = getopt(argc, (char* const*)argv, "t:s:g:z:x:W:R:S:k:P")) != -1) {
+    switch (opt) {
+    case 't':
+      if (!parseTransportMode(optarg, &transportMode)) {
+        fprintf(stderr, "Unknown transport %s\n", optarg);
+        exit(1);
       }
+      break;
+    case 's':
+      slot = atoi(optarg);
+      break;
+    case 'g':
+      config.pagesPerProcess = atoi(optarg);
+      break;
+    case 'z':
+      config.pageSize = atoi(optarg);
+      break;
+    case 'x':
+      config.addressBits = atoi(optarg);
+      break;
+    case 'W':
+      if (!parseWorkload(optarg, &workload)) {
+        fprintf(stderr, "Unknown workload %s\n", optarg);
+        exit(1);
+      }
+      break;
+    case 'R':
+      workload.readPercent = atoi(optarg);
+      break;
+    case 'S':
+      seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'k':
+      batch = atoi(optarg);
+      break;
+    case 'P':
+      pooled = true;
+      break;
+    default:
+      exit(1);
     }
+  }
 
-    int addr = rand() % 32 * 1024 + rand() % 1024; // Generate a random memory address within the accessible range
+  if (config.addressBits == 0) config.addressBits = denseAddressBits(&config);
 
-    MemoryRequest request;
-    request.msg_type = 1;
-    request.pid = getpid();
-    request.address = addr;
-    request.isRead = rand() % 100 < 75 ? true : false; // Randomly determine whether it's a read or write request
+  if (batch < 1 || batch > MAX_REQUEST_BATCH) {
+    fprintf(stderr, "A request carries between 1 and %d references\n", MAX_REQUEST_BATCH);
+    exit(1);
+  }
+  if (transportMode == TRANSPORT_THREAD) {
+    fprintf(stderr, "The thread transport only works for user processes run inside oss\n");
+    exit(1);
+  }
+  // Replies are addressed to the slot on either transport
+  if (slot < 0) {
+    fprintf(stderr, "A user process requires a process slot\n");
+    exit(1);
+  }
 
-    if (msgsnd(msgqid, &request, sizeof(request) - sizeof(long), 0) == -1) {
-      perror("msgsnd");
-      exit(1);
-    }
-    requestsSinceLastCheck++;
+  // Only channels up to our own slot need to be mapped
+  Transport transport;
+  if (!openTransport(&transport, transportMode, slot + 1)) {
+    exit(1);
+  }
 
-    if (msgrcv(msgqid, &request, sizeof(MemoryRequest) - sizeof(long), getpid(), 0) == -1) {
-      if (errno != ENOMSG) { // Ignore ENOMSG errors
-        perror("msgrcv failed");
-        exit(1);
-      }
-    }
+  UserLoop loop;
+  loop.transport = &transport;
+  loop.slot = slot;
+  loop.pid = getpid();
+  loop.config = config;
+  loop.workload = workload;
+  loop.seed = seed;
+  loop.batch = batch;
+  if (pooled) {
+    runUserPool(&loop);
+  } else {
+    runUserLoop(&loop);
   }
 
   return 0;
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "user_loop.h"
+#include "user_threads.h"
+
+// The user loop needs very little stack, and small stacks let many threads run at once
+#define USER_THREAD_STACK_SIZE (64 * 1024)
+
+typedef enum {
+  USER_THREAD_FREE,
+  USER_THREAD_RUNNING,
+  USER_THREAD_EXITED // finished but not joined yet
+} UserThreadState;
+
+// A user process run as a thread inside oss, one per process slot
+typedef struct {
+  pthread_t thread;
+  _Atomic int state;
+  UserLoop loop;
+} UserThread;
+
+UserThread* userThreads;
+int userThreadCount;
+_Atomic int userThreadsExited;
+
+bool initUserThreads(int slotCount) {
+  userThreads = calloc(slotCount, sizeof(UserThread));
+  if (userThreads == NULL) {
+    perror("calloc");
+    return false;
+  }
+  userThreadCount = slotCount;
+  atomic_store(&userThreadsExited, 0);
+  return true;
+}
+
+void freeUserThreads() {
+  free(userThreads);
+  userThreads = NULL;
+  userThreadCount = 0;
+}
+
+// Thread body: run the user loop, then tell oss the process has terminated the way a
+// SIGCHLD would
+void* userThreadMain(void* arg) {
+  UserThread* userThread = (UserThread*)arg;
+  runUserLoop(&userThread->loop);
+
+  atomic_store(&userThread->state, USER_THREAD_EXITED);
+  atomic_fetch_add(&userThreadsExited, 1);
+  wakeTransport(userThread->loop.transport);
+  return NULL;
+}
+
+// Start a user process as a thread in slot. pid is the simulated process id it reports.
+bool startUserThread(Transport* transport, int slot, int pid, const PagingConfig* config,
+  const WorkloadConfig* workload, uint64_t seed, int batch) {
+  UserThread* userThread = &userThreads[slot];
+  userThread->loop.transport = transport;
+  userThread->loop.slot = slot;
+  userThread->loop.pid = pid;
+  userThread->loop.config = *config;
+  userThread->loop.workload = *workload;
+  userThread->loop.seed = seed;
+  userThread->loop.batch = batch;
+  atomic_store(&userThread->state, USER_THREAD_RUNNING);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, USER_THREAD_STACK_SIZE);
+  int error = pthread_create(&userThread->thread, &attr, userThreadMain, userThread);
+  pthread_attr_destroy(&attr);
+  if (error != 0) {
+    fprintf(stderr, "pthread_create: %s\n", strerror(error));
+    atomic_store(&userThread->state, USER_THREAD_FREE);
+    return false;
+  }
+  return true;
+}
+
+// Returns true if a user thread has finished but hasn't been reaped yet
+bool userThreadExitPending() {
+  return atomic_load(&userThreadsExited) > 0;
+}
+
+// Join one finished user thread and return its simulated pid, or 0 if none has finished
+int reapUserThread() {
+  if (!userThreadExitPending()) return 0;
+
+  int i;
+  for (i = 0; i < userThreadCount; i++) {
+    UserThread* userThread = &userThreads[i];
+    if (atomic_load(&userThread->state) != USER_THREAD_EXITED) continue;
+
+    pthread_join(userThread->thread, NULL);
+    atomic_store(&userThread->state, USER_THREAD_FREE);
+    atomic_fetch_sub(&userThreadsExited, 1);
+    return userThread->loop.pid;
+  }
+  return 0;
+}
+
+// Number of user threads started and not yet joined
+int userThreadsRunning() {
+  int running = 0;
+  int i;
+  for (i = 0; i < userThreadCount; i++) {
+    if (atomic_load(&userThreads[i].state) != USER_THREAD_FREE) running++;
+  }
+  return running;
+}
@@ -0,0 +1,18 @@
+#ifndef USER_THREADS_H
+#define USER_THREADS_H
+
+#include <stdbool.h>
+
+#include "transport.h"
+#include "workload.h"
+
+bool initUserThreads(int slotCount);
+void freeUserThreads();
+
+bool startUserThread(Transport* transport, int slot, int pid, const PagingConfig* config,
+  const WorkloadConfig* workload, uint64_t seed, int batch);
+bool userThreadExitPending();
+int reapUserThread();
+int userThreadsRunning();
+
+#endif /* USER_THREADS_H */
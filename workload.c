@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "workload.h"
+
+// Reference streams for user processes. A process refills a batch of WORKLOAD_BATCH
+// references at once, so the random number generation and the distribution lookups stay
+// off the path of each request.
+
+const char* workloadNames[] = { "uniform", "zipf", "scan", "loop", "phase", "mix" };
+
+void defaultWorkloadConfig(WorkloadConfig* config) {
+  config->kind = WORKLOAD_UNIFORM;
+  config->theta = DEFAULT_ZIPF_THETA;
+  config->pages = 0;
+  config->length = DEFAULT_PHASE_LENGTH;
+  config->scanPercent = DEFAULT_SCAN_PERCENT;
+  config->readPercent = DEFAULT_READ_PERCENT;
+}
+
+// Parse a workload from the command line: uniform, zipf[:theta], scan, loop[:pages],
+// phase[:pages[:length]] or mix[:scan percent[:theta]]. The read percentage is kept.
+bool parseWorkload(const char* spec, WorkloadConfig* config) {
+  int readPercent = config->readPercent;
+  defaultWorkloadConfig(config);
+  config->readPercent = readPercent;
+
+  const char* colon = strchr(spec, ':');
+  size_t nameLength = colon == NULL ? strlen(spec) : (size_t)(colon - spec);
+  const char* args = colon == NULL ? "" : colon + 1;
+
+  int i;
+  for (i = 0; i <= WORKLOAD_MIX; i++) {
+    if (strlen(workloadNames[i]) == nameLength && strncmp(workloadNames[i], spec, nameLength) == 0) break;
+  }
+  if (i > WORKLOAD_MIX) return false;
+  config->kind = (WorkloadKind)i;
+
+  if (*args == '\0') return colon == NULL;
+  switch (config->kind) {
+  case WORKLOAD_ZIPF:
+    return sscanf(args, "%lf", &config->theta) == 1;
+  case WORKLOAD_LOOP:
+    return sscanf(args, "%d", &config->pages) == 1;
+  case WORKLOAD_PHASE:
+    return sscanf(args, "%d:%d", &config->pages, &config->length) >= 1;
+  case WORKLOAD_MIX:
+    return sscanf(args, "%d:%lf", &config->scanPercent, &config->theta) >= 1;
+  default:
+    return false;
+  }
+}
+
+// Check that a workload fits processes of pagesPerProcess pages, printing the problem if
+// it doesn't
+bool checkWorkloadConfig(const WorkloadConfig* config, int pagesPerProcess) {
+  if (config->readPercent < 0 || config->readPercent > 100) {
+    fprintf(stderr, "The read percentage must be between 0 and 100\n");
+    return false;
+  }
+  if (config->theta <= 0) {
+    fprintf(stderr, "Zipf theta must be greater than 0\n");
+    return false;
+  }
+  if (config->pages < 0 || config->pages > pagesPerProcess) {
+    fprintf(stderr, "A loop or working set must be between 1 and %d pages\n", pagesPerProcess);
+    return false;
+  }
+  if (config->length < 1) {
+    fprintf(stderr, "A phase must last at least one reference\n");
+    return false;
+  }
+  if (config->scanPercent < 0 || config->scanPercent > 100) {
+    fprintf(stderr, "The scan percentage must be between 0 and 100\n");
+    return false;
+  }
+  return true;
+}
+
+// splitmix64, used to spread one seed over the generator state
+uint64_t splitMix(uint64_t* x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// Seed of the process-th process of a run, so a run seed reproduces every process's
+// references
+uint64_t workloadSeed(uint64_t runSeed, int process) {
+  uint64_t x = runSeed ^ ((uint64_t)process * 0xd1b54a32d192ed03ULL);
+  return splitMix(&x);
+}
+
+uint64_t rotateLeft(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+// Fill out with count random numbers, a multiple of WORKLOAD_LANES, stepping every lane
+// once per group
+void fillRandom(Workload* workload, uint64_t* out, int count) {
+  uint64_t (*s)[WORKLOAD_LANES] = workload->state;
+  int i, lane;
+  for (i = 0; i < count; i += WORKLOAD_LANES) {
+    for (lane = 0; lane < WORKLOAD_LANES; lane++) {
+      out[i + lane] = rotateLeft(s[1][lane] * 5, 7) * 9;
+      uint64_t t = s[1][lane] << 17;
+      s[2][lane] ^= s[0][lane];
+      s[3][lane] ^= s[1][lane];
+      s[1][lane] ^= s[2][lane];
+      s[0][lane] ^= s[3][lane];
+      s[2][lane] ^= t;
+      s[3][lane] = rotateLeft(s[3][lane], 45);
+    }
+  }
+}
+
+bool initWorkload(Workload* workload, const WorkloadConfig* config, const PagingConfig* paging, uint64_t seed) {
+  workload->config = *config;
+  workload->paging = *paging;
+  int pages = paging->pagesPerProcess;
+  if (workload->config.pages == 0) {
+    workload->config.pages = config->kind == WORKLOAD_PHASE ? (pages + 3) / 4 : (pages + 1) / 2;
+  }
+
+  int i, j;
+  for (i = 0; i < 4; i++) {
+    for (j = 0; j < WORKLOAD_LANES; j++) {
+      workload->state[i][j] = splitMix(&seed);
+    }
+  }
+
+  workload->zipfCdf = NULL;
+  if (config->kind == WORKLOAD_ZIPF || config->kind == WORKLOAD_MIX) {
+    workload->zipfCdf = malloc(sizeof(double) * pages);
+    if (workload->zipfCdf == NULL) {
+      perror("malloc");
+      return false;
+    }
+    double sum = 0;
+    for (i = 0; i < pages; i++) {
+      sum += 1.0 / pow(i + 1, config->theta);
+      workload->zipfCdf[i] = sum;
+    }
+    for (i = 0; i < pages; i++) {
+      workload->zipfCdf[i] /= sum;
+    }
+  }
+
+  workload->next = WORKLOAD_BATCH;
+  workload->cursor = 0;
+  workload->phaseBase = 0;
+  workload->phaseLeft = 0;
+  return true;
+}
+
+void freeWorkload(Workload* workload) {
+  free(workload->zipfCdf);
+  workload->zipfCdf = NULL;
+}
+
+// A number below bound from the top 32 bits of a random number
+int randomBelow(uint64_t random, int bound) {
+  return (int)(((random >> 32) * (uint64_t)bound) >> 32);
+}
+
+// Page picked by the zipf distribution for a random number
+int zipfPage(const Workload* workload, uint64_t random) {
+  double u = (random >> 11) * 0x1.0p-53;
+  int low = 0;
+  int high = workload->paging.pagesPerProcess - 1;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (workload->zipfCdf[middle] < u) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+// Next page of the scan, wrapping after pages pages
+int scanPage(Workload* workload, int pages) {
+  int page = workload->cursor;
+  workload->cursor = (page + 1) % pages;
+  return page;
+}
+
+// Generate the next batch of references. Each takes two random numbers: one picks the
+// page, the other the offset in it and whether it is a read.
+void refillBatch(Workload* workload) {
+  fillRandom(workload, workload->random, 2 * WORKLOAD_BATCH);
+
+  const WorkloadConfig* config = &workload->config;
+  int pages = workload->paging.pagesPerProcess;
+  uint64_t offsetMask = workload->paging.pageSize - 1;
+  int i;
+  for (i = 0; i < WORKLOAD_BATCH; i++) {
+    uint64_t pick = workload->random[2 * i];
+    uint64_t detail = workload->random[2 * i + 1];
+    uint32_t high = detail >> 32;
+
+    int n;
+    switch (config->kind) {
+    case WORKLOAD_ZIPF:
+      n = zipfPage(workload, pick);
+      break;
+    case WORKLOAD_SCAN:
+      n = scanPage(workload, pages);
+      break;
+    case WORKLOAD_LOOP:
+      n = scanPage(workload, config->pages);
+      break;
+    case WORKLOAD_PHASE:
+      if (workload->phaseLeft == 0) {
+        workload->phaseBase = randomBelow(pick << 32, pages - config->pages + 1);
+        workload->phaseLeft = config->length;
+      }
+      workload->phaseLeft--;
+      n = workload->phaseBase + randomBelow(pick, config->pages);
+      break;
+    case WORKLOAD_MIX:
+      n = (int)(high / 100 % 100) < config->scanPercent ? scanPage(workload, pages) : zipfPage(workload, pick);
+      break;
+    default:
+      n = randomBelow(pick, pages);
+      break;
+    }
+
+    workload->addresses[i] = (uint64_t)processPageNumber(&workload->paging, n) * workload->paging.pageSize +
+      (detail & offsetMask);
+    workload->reads[i] = (int)(high % 100) < config->readPercent;
+  }
+  workload->next = 0;
+}
+
+// Hand out the next reference of the workload
+void nextReference(Workload* workload, uint64_t* address, bool* isRead) {
+  if (workload->next == WORKLOAD_BATCH) refillBatch(workload);
+  *address = workload->addresses[workload->next];
+  *isRead = workload->reads[workload->next];
+  workload->next++;
+}
+
+// A random number from the workload's generator for decisions outside the reference
+// stream
+uint64_t workloadRandom(Workload* workload) {
+  uint64_t random[WORKLOAD_LANES];
+  fillRandom(workload, random, WORKLOAD_LANES);
+  return random[0];
+}
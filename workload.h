@@ -0,0 +1,64 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "structs.h"
+
+// References generated at a time, and independent random streams generated side by side
+#define WORKLOAD_BATCH 256
+#define WORKLOAD_LANES 4
+
+#define DEFAULT_READ_PERCENT 75
+#define DEFAULT_ZIPF_THETA 0.99
+#define DEFAULT_PHASE_LENGTH 2000
+#define DEFAULT_SCAN_PERCENT 20
+
+typedef enum {
+  WORKLOAD_UNIFORM, // every page equally likely
+  WORKLOAD_ZIPF,    // page n has weight 1 / (n + 1)^theta
+  WORKLOAD_SCAN,    // every page in order, over and over
+  WORKLOAD_LOOP,    // the first pages pages in order, over and over
+  WORKLOAD_PHASE,   // uniform over a window of pages that moves every length references
+  WORKLOAD_MIX      // a zipf workload with a sequential scan mixed in
+} WorkloadKind;
+
+// Which pages each user process references and how often it writes. Parameters a kind
+// doesn't use are ignored; 0 pages means a default based on the process size.
+typedef struct {
+  WorkloadKind kind;
+  double theta;     // zipf, mix: skew of page popularity
+  int pages;        // loop: pages cycled through; phase: pages in the working set
+  int length;       // phase: references before the working set moves
+  int scanPercent;  // mix: references that belong to the scan
+  int readPercent;
+} WorkloadConfig;
+
+// A workload in progress. Random numbers come from WORKLOAD_LANES interleaved
+// xoshiro256** generators, so filling a batch is a loop the compiler can vectorize.
+typedef struct {
+  WorkloadConfig config;
+  PagingConfig paging;
+  uint64_t state[4][WORKLOAD_LANES];
+  uint64_t random[2 * WORKLOAD_BATCH];
+  uint64_t addresses[WORKLOAD_BATCH];
+  bool reads[WORKLOAD_BATCH];
+  int next;         // next reference of the batch to hand out
+  double* zipfCdf;  // cumulative popularity of each page, for zipf and mix
+  int cursor;       // next page of a scan or loop
+  int phaseBase;    // first page of the current working set
+  int phaseLeft;    // references before it moves
+} Workload;
+
+void defaultWorkloadConfig(WorkloadConfig* config);
+bool parseWorkload(const char* spec, WorkloadConfig* config);
+bool checkWorkloadConfig(const WorkloadConfig* config, int pagesPerProcess);
+uint64_t workloadSeed(uint64_t runSeed, int process);
+
+bool initWorkload(Workload* workload, const WorkloadConfig* config, const PagingConfig* paging, uint64_t seed);
+void freeWorkload(Workload* workload);
+void nextReference(Workload* workload, uint64_t* address, bool* isRead);
+uint64_t workloadRandom(Workload* workload);
+
+#endif /* WORKLOAD_H */
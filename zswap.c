@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "zswap.h"
+
+// Compressed swap tier, in the manner of zswap. A page the replacement policy evicts is
+// compressed into a pool of fixed size instead of going to disk, and a fault on it is
+// served by decompressing it, which is far cheaper than a disk read. A load takes the page
+// out of the pool. When the pool is full the pages that have been in it longest go on to
+// disk, which means a write for the dirty ones. Pages that barely compress are sent to
+// disk as though there were no pool.
+
+ZswapConfig zswapConfig = { 0, DEFAULT_ZSWAP_RATIO, DEFAULT_ZSWAP_SPREAD };
+ZswapCounts zswapCounts;
+
+// A compressed page. Entries are on the LRU list, oldest at head, on their slot's list,
+// and in a hash chain.
+typedef struct {
+  int slot;
+  long long page;
+  int size;     // compressed bytes
+  bool dirty;   // the disk copy is out of date
+  int prev;
+  int next;
+  int slotPrev;
+  int slotNext;
+  int hashNext;
+} ZswapEntry;
+
+ZswapEntry* zswapEntries;
+int zswapCapacity;
+int zswapFreeList;
+int* zswapBuckets;
+int zswapBucketCount;
+int* zswapSlotHeads;
+int zswapOldest;
+int zswapNewest;
+size_t zswapUsed;
+size_t zswapBudget;
+int zswapPageSize;
+
+// Parse "frames[:ratio[:spread]]" from the command line
+bool parseZswapConfig(const char* text, ZswapConfig* config) {
+  config->ratio = DEFAULT_ZSWAP_RATIO;
+  config->spread = DEFAULT_ZSWAP_SPREAD;
+  return sscanf(text, "%d:%lf:%lf", &config->frames, &config->ratio, &config->spread) >= 1;
+}
+
+// Check that the pool is usable, printing the problem if it isn't
+bool checkZswapConfig(const ZswapConfig* config) {
+  if (config->frames < 0) {
+    fprintf(stderr, "The compressed pool can't have a negative size\n");
+    return false;
+  }
+  if (config->ratio < 1 || config->spread < 0 || config->spread >= config->ratio) {
+    fprintf(stderr, "The compression ratio must be at least 1 and more than its spread\n");
+    return false;
+  }
+  return true;
+}
+
+bool initZswap(int processCount, int pageSize) {
+  freeZswap();
+  zswapCounts = (ZswapCounts){ 0, 0, 0, 0, 0 };
+  if (zswapConfig.frames == 0) return true;
+
+  // No page takes less than pageSize / (ratio + spread) bytes, which bounds the entries
+  zswapCapacity = (int)ceil(zswapConfig.frames * (zswapConfig.ratio + zswapConfig.spread)) + 1;
+  zswapBucketCount = 2 * zswapCapacity;
+  zswapEntries = malloc(sizeof(ZswapEntry) * zswapCapacity);
+  zswapBuckets = malloc(sizeof(int) * zswapBucketCount);
+  zswapSlotHeads = malloc(sizeof(int) * processCount);
+  if (zswapEntries == NULL || zswapBuckets == NULL || zswapSlotHeads == NULL) {
+    perror("malloc");
+    freeZswap();
+    return false;
+  }
+
+  int i;
+  for (i = 0; i < zswapBucketCount; i++) {
+    zswapBuckets[i] = -1;
+  }
+  for (i = 0; i < processCount; i++) {
+    zswapSlotHeads[i] = -1;
+  }
+  for (i = 0; i < zswapCapacity; i++) {
+    zswapEntries[i].next = i + 1 < zswapCapacity ? i + 1 : -1;
+  }
+  zswapFreeList = 0;
+  zswapOldest = -1;
+  zswapNewest = -1;
+  zswapUsed = 0;
+  zswapBudget = (size_t)zswapConfig.frames * pageSize;
+  zswapPageSize = pageSize;
+  return true;
+}
+
+void freeZswap() {
+  free(zswapEntries);
+  free(zswapBuckets);
+  free(zswapSlotHeads);
+  zswapEntries = NULL;
+  zswapBuckets = NULL;
+  zswapSlotHeads = NULL;
+}
+
+bool zswapEnabled() {
+  return zswapEntries != NULL;
+}
+
+// Bytes of compressed pages in the pool
+size_t zswapUsedBytes() {
+  return zswapUsed;
+}
+
+uint64_t zswapHash(int slot, long long page) {
+  uint64_t h = (uint64_t)page * 0x9e3779b97f4a7c15ULL ^ (uint64_t)slot * 0xc2b2ae3d27d4eb4fULL;
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  return h ^ (h >> 32);
+}
+
+// Size a page compresses to. The ratio comes from the page's hash, so the same page
+// always compresses the same way.
+int compressedSize(int slot, long long page) {
+  double u = (zswapHash(slot, page) >> 11) * 0x1.0p-53;
+  double ratio = zswapConfig.ratio + zswapConfig.spread * (2 * u - 1);
+  if (ratio < ZSWAP_MIN_RATIO) return -1;
+  return (int)ceil(zswapPageSize / ratio);
+}
+
+int findZswapEntry(int slot, long long page) {
+  int index = zswapBuckets[zswapHash(slot, page) % zswapBucketCount];
+  while (index != -1 && (zswapEntries[index].slot != slot || zswapEntries[index].page != page)) {
+    index = zswapEntries[index].hashNext;
+  }
+  return index;
+}
+
+// Take an entry out of the pool
+void removeZswapEntry(int index) {
+  ZswapEntry* entry = &zswapEntries[index];
+
+  int* link = &zswapBuckets[zswapHash(entry->slot, entry->page) % zswapBucketCount];
+  while (*link != index) {
+    link = &zswapEntries[*link].hashNext;
+  }
+  *link = entry->hashNext;
+
+  if (entry->prev != -1) zswapEntries[entry->prev].next = entry->next;
+  else zswapOldest = entry->next;
+  if (entry->next != -1) zswapEntries[entry->next].prev = entry->prev;
+  else zswapNewest = entry->prev;
+
+  if (entry->slotPrev != -1) zswapEntries[entry->slotPrev].slotNext = entry->slotNext;
+  else zswapSlotHeads[entry->slot] = entry->slotNext;
+  if (entry->slotNext != -1) zswapEntries[entry->slotNext].slotPrev = entry->slotPrev;
+
+  zswapUsed -= entry->size;
+  entry->next = zswapFreeList;
+  zswapFreeList = index;
+}
+
+// Push the oldest page out to disk. Returns 1 if it had to be written.
+int evictOldestZswap() {
+  bool dirty = zswapEntries[zswapOldest].dirty;
+  removeZswapEntry(zswapOldest);
+  if (dirty) {
+    zswapCounts.writeBacks++;
+    return 1;
+  }
+  zswapCounts.drops++;
+  return 0;
+}
+
+// A fault on a page: if the pool holds it, take it out and return true, with dirty set
+// if the page has to be treated as written to since it was last on disk
+bool zswapLoad(int slot, long long page, bool* dirty) {
+  int index = findZswapEntry(slot, page);
+  if (index == -1) return false;
+  *dirty = zswapEntries[index].dirty;
+  removeZswapEntry(index);
+  zswapCounts.loads++;
+  return true;
+}
+
+// Compress an evicted page into the pool, making room by pushing the oldest pages out.
+// Returns the number of dirty pages that have to be written to disk before the frame can
+// be reused: the page itself if it compresses too poorly to keep, or pages pushed out.
+int zswapStore(int slot, long long page, bool dirty) {
+  int old = findZswapEntry(slot, page);
+  if (old != -1) removeZswapEntry(old);
+
+  int size = compressedSize(slot, page);
+  if (size < 0) {
+    zswapCounts.rejects++;
+    return dirty ? 1 : 0;
+  }
+
+  int written = 0;
+  while (zswapOldest != -1 && (zswapUsed + size > zswapBudget || zswapFreeList == -1)) {
+    written += evictOldestZswap();
+  }
+  if ((size_t)size > zswapBudget) {
+    zswapCounts.rejects++;
+    return written + (dirty ? 1 : 0);
+  }
+
+  int index = zswapFreeList;
+  ZswapEntry* entry = &zswapEntries[index];
+  zswapFreeList = entry->next;
+  entry->slot = slot;
+  entry->page = page;
+  entry->size = size;
+  entry->dirty = dirty;
+
+  int bucket = zswapHash(slot, page) % zswapBucketCount;
+  entry->hashNext = zswapBuckets[bucket];
+  zswapBuckets[bucket] = index;
+
+  entry->prev = zswapNewest;
+  entry->next = -1;
+  if (zswapNewest != -1) zswapEntries[zswapNewest].next = index;
+  else zswapOldest = index;
+  zswapNewest = index;
+
+  entry->slotPrev = -1;
+  entry->slotNext = zswapSlotHeads[slot];
+  if (entry->slotNext != -1) zswapEntries[entry->slotNext].slotPrev = index;
+  zswapSlotHeads[slot] = index;
+
+  zswapUsed += size;
+  zswapCounts.stores++;
+  return written;
+}
+
+// A reference displaced a page. Returns the dirty pages to write to disk before its
+// frame can be read into: the victim goes to the pool if there is one, and otherwise is
+// written if it is dirty. A shared page is never dirty and is read back from its file,
+// so it doesn't go to the pool.
+int zswapEvicted(const AccessResult* result) {
+  if (!result->evicted) return 0;
+  if (!zswapEnabled() || result->evictedProcess == -1) return result->evictedDirty ? 1 : 0;
+  return zswapStore(result->evictedProcess, result->evictedPage, result->evictedDirty);
+}
+
+// The process in a slot terminated: its pages in the pool are thrown away
+void zswapProcessRemoved(int slot) {
+  while (zswapSlotHeads[slot] != -1) {
+    removeZswapEntry(zswapSlotHeads[slot]);
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef ZSWAP_H
+#define ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "structs.h"
+
+// Simulated time to decompress a page out of the pool on a fault
+#define ZSWAP_LOAD_NANOS 10000
+#define DEFAULT_ZSWAP_RATIO 3.0
+#define DEFAULT_ZSWAP_SPREAD 1.0
+// Pages that compress worse than this go straight to disk, as they would save little
+#define ZSWAP_MIN_RATIO 1.25
+
+// Compressed in-memory swap tier between the frames and the disk. frames is the memory
+// the pool may use, in frames, 0 when it is off. Each page compresses by a ratio drawn
+// uniformly from ratio - spread to ratio + spread.
+typedef struct {
+  int frames;
+  double ratio;
+  double spread;
+} ZswapConfig;
+
+// What the pool has done since it was set up
+typedef struct {
+  unsigned long long loads;      // faults served from the pool
+  unsigned long long stores;     // evicted pages compressed into it
+  unsigned long long rejects;    // evicted pages that compressed too poorly and went to disk
+  unsigned long long writeBacks; // dirty pages pushed out of the pool to disk
+  unsigned long long drops;      // clean pages pushed out of the pool, whose disk copy is current
+} ZswapCounts;
+
+extern ZswapConfig zswapConfig;
+extern ZswapCounts zswapCounts;
+
+bool parseZswapConfig(const char* text, ZswapConfig* config);
+bool checkZswapConfig(const ZswapConfig* config);
+
+bool initZswap(int processCount, int pageSize);
+void freeZswap();
+bool zswapEnabled();
+size_t zswapUsedBytes();
+
+bool zswapLoad(int slot, long long page, bool* dirty);
+int zswapStore(int slot, long long page, bool dirty);
+int zswapEvicted(const AccessResult* result);
+void zswapProcessRemoved(int slot);
+
+#endif /* ZSWAP_H */